@@ -25,14 +25,14 @@ class Calculator : public Grammar<T> {
         Calculator() : Grammar<T>("(end)") {
             Grammar<T>::add_symbol_to_dict("(number)", 0)\
             .set_scanner(
-            [](const std::string& str, size_t pos) -> size_t {
-            std::string::size_type i = pos;
+            [](StringRef str, size_t pos) -> size_t {
+            size_t i = pos;
                 while(i < str.length() && isdigit(str[i]))
                     ++i;
                 return i;
-            })\
+            }, "0123456789")\
             .set_parser(
-            [](const std::string& str, size_t beg, size_t end) -> T {
+            [](StringRef str, size_t beg, size_t end) -> T {
                 T num = 0;
                 for (size_t i = beg; i != end; ++i)
                     num *= 10, num += str[i] - '0';
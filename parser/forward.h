@@ -5,5 +5,13 @@ template <typename T> class PrattParser;
 template <typename T> class Symbol;
 template <typename T> class SymbolDict;
 template <typename T> class Token;
+template <typename T> class Lexer;
+template <typename T> class TokenStream;
+template <typename T> class TokenDocument;
+template <typename T> class Mode;
+template <typename T> struct Combinator;
+
+class LineIndex;
+class ChunkedReader;
 
 #endif
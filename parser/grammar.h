@@ -2,8 +2,10 @@
 #define PARSER_GRAMMAR_H
 
 #include "forward.h"
+#include "string_ref.h"
 
 #include <string>
+#include <vector>
 #include <functional>
 
 namespace grammar {
@@ -25,12 +27,18 @@ namespace grammar {
             Symbol<T>& infix_r(const std::string&, int, std::function<T(T, T)>);
             Symbol<T>& brackets(const std::string&, const std::string&, 
                     int, std::function<T(T)>);
+            /// Same as above, but the closing bracket is consumed by \a close
+            Symbol<T>& brackets(const std::string&, int, 
+                    std::function<void(PrattParser<T>&)> close, std::function<T(T)>);
            
-            T parse(const std::string& text) const;
+            T parse(StringRef text) const;
             T parse(const char* text) const;
            
             const SymbolDict<T>& get_symbols() const;
 
+            /// See SymbolDict::set_case_sensitive
+            void set_case_sensitive(bool sensitive);
+
             struct Prefix { 
                 typedef std::function<T(T)> handler_type;
                 typedef std::function<T(PrattParser<T>&)> func_type;
@@ -47,8 +55,11 @@ namespace grammar {
                 typedef std::function<T(T,T)> handler_type; 
                 typedef std::function<T(PrattParser<T>&, T)> func_type;
             };
-
-            template <typename U> struct type {};
+            /// Right-associative separator, the handler gets all the operands
+            struct List {
+                typedef std::function<T(std::vector<T>&&)> handler_type;
+                typedef std::function<T(PrattParser<T>&, T)> func_type;
+            };
 
             template <typename _Semantics> static void 
             set_behaviour(Symbol<T>& sym, typename _Semantics::handler_type func);
@@ -56,76 +67,48 @@ namespace grammar {
             template <typename _Semantics> static void 
             set_behaviour(Symbol<T>& sym, int rbp, typename _Semantics::handler_type func);
 
-            template <typename _Semantics>
-            struct behaviour_guard {
-                behaviour_guard(Symbol<T>& sym, typename _Semantics::handler_type func);
-                behaviour_guard(Symbol<T>& sym, int rbp, typename _Semantics::handler_type func);
-                ~behaviour_guard();
+            /// Same as above but the behaviour is set in \a mode only
+            template <typename _Semantics> static void 
+            set_behaviour(Mode<T>& mode, const Symbol<T>& sym, 
+                          typename _Semantics::handler_type func);
+
+            template <typename _Semantics> static void 
+            set_behaviour(Mode<T>& mode, const Symbol<T>& sym, int rbp, 
+                          typename _Semantics::handler_type func);
+
+            /// Keeps \a mode entered in \a parser while the guard exists
+            struct mode_guard {
+                mode_guard(PrattParser<T>& parser, const Mode<T>& mode);
+                ~mode_guard();
             private:
-                typename _Semantics::func_type old_func;        
-                Symbol<T>& sym;
+                PrattParser<T>& parser;
+                const Mode<T>& mode;
             };
 
-#define __DECLARE_GRAMMAR_GUARD__(__field_name, __field_type) \
-            struct __field_name##_guard { \
-                __field_name##_guard(Symbol<T>&, __field_type); \
-                ~__field_name##_guard(); \
-            private: \
-                Symbol<T>& sym; \
-                __field_type old_##__field_name; \
-            }
-
-#define __DEFINE_GRAMMAR_GUARD__(__field_name, __field_type) \
-template <typename T> \
-Grammar<T>::__field_name##_guard::__field_name##_guard(Symbol<T>& s, __field_type f) : \
-            sym(s), old_##__field_name(std::move(s.__field_name)) { \
-    sym.__field_name = std::move(f); \
-} \
-\
-template <typename T> \
-Grammar<T>::__field_name##_guard::~__field_name##_guard() { \
-    sym.__field_name = std::move(old_##__field_name); \
-}
-
-            __DECLARE_GRAMMAR_GUARD__(lbp, int);
-            __DECLARE_GRAMMAR_GUARD__(nud, typename Prefix::func_type);
-            __DECLARE_GRAMMAR_GUARD__(led, typename LeftAssociative::func_type);
-
         private:
-            static void set_behaviour_helper
-                (Prefix, Symbol<T>& sym, std::function<T(T)> f);
-            static void set_behaviour_helper
-                (Prefix, Symbol<T>& sym, std::function<T(T)> f, int rbp);
-            static void set_behaviour_helper
-                (Postfix, Symbol<T>& sym, std::function<T(T)> f, int rbp=0);
-            static void set_behaviour_helper
-                (LeftAssociative, Symbol<T>& sym, std::function<T(T, T)> f);
-            static void set_behaviour_helper
-                (LeftAssociative, Symbol<T>& sym, std::function<T(T, T)> f, int rbp);
-            static void set_behaviour_helper
-                (RightAssociative, Symbol<T>& sym, std::function<T(T, T)> f);
-            static void set_behaviour_helper
-                (RightAssociative, Symbol<T>& sym, std::function<T(T, T)> f, int rbp);
-
-            template <typename _Func>
-            static _Func&& get_handler(Symbol<T>& sym);
-
-            static std::function<T(PrattParser<T>&)>&& get_handler_helper
-                (type<std::function<T(PrattParser<T>&)>>, Symbol<T>& sym);
-
-            static std::function<T(PrattParser<T>&, T)>&& get_handler_helper
-                (type<std::function<T(PrattParser<T>&, T)>>, Symbol<T>& sym);
-
-            template <typename _Func>
-            static void restore_behaviour(Symbol<T>& sym, _Func& f);
-
-            static void restore_behaviour_helper
-                (type<std::function<T(PrattParser<T>&)>>, Symbol<T>& sym, 
-                      std::function<T(PrattParser<T>&)>& f);
-
-            static void restore_behaviour_helper
-                (type<std::function<T(PrattParser<T>&, T)>>, Symbol<T>& sym, 
-                      std::function<T(PrattParser<T>&, T)>& f);
+            static typename Prefix::func_type make_behaviour
+                (Prefix, const Symbol<T>& sym, std::function<T(T)> f);
+            static typename Prefix::func_type make_behaviour
+                (Prefix, const Symbol<T>& sym, std::function<T(T)> f, int rbp);
+            static typename Postfix::func_type make_behaviour
+                (Postfix, const Symbol<T>& sym, std::function<T(T)> f, int rbp=0);
+            static typename LeftAssociative::func_type make_behaviour
+                (LeftAssociative, const Symbol<T>& sym, std::function<T(T, T)> f);
+            static typename LeftAssociative::func_type make_behaviour
+                (LeftAssociative, const Symbol<T>& sym, std::function<T(T, T)> f, int rbp);
+            static typename RightAssociative::func_type make_behaviour
+                (RightAssociative, const Symbol<T>& sym, std::function<T(T, T)> f);
+            static typename RightAssociative::func_type make_behaviour
+                (RightAssociative, const Symbol<T>& sym, std::function<T(T, T)> f, int rbp);
+            static typename List::func_type make_behaviour
+                (List, const Symbol<T>& sym, std::function<T(std::vector<T>&&)> f);
+            static typename List::func_type make_behaviour
+                (List, const Symbol<T>& sym, std::function<T(std::vector<T>&&)> f, int rbp);
+
+            static void assign(Symbol<T>& sym, typename Prefix::func_type f);
+            static void assign(Symbol<T>& sym, typename Postfix::func_type f);
+            static void assign(Mode<T>& mode, const Symbol<T>& sym, typename Prefix::func_type f);
+            static void assign(Mode<T>& mode, const Symbol<T>& sym, typename Postfix::func_type f);
 
             SymbolDict<T> symbols;
     };
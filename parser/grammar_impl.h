@@ -4,16 +4,12 @@
 #include "grammar.h"
 #include <utility>
 
-#ifdef DEBUG
-#include <iostream>
-#endif
-
 namespace grammar {
 
 template <typename T>
 Grammar<T>::Grammar(const std::string& end_id) : symbols(end_id) {
     symbols[end_id].set_scanner(
-        [](const std::string&, size_t pos){ return pos; }
+        [](StringRef, size_t pos){ return pos; }, ""
     );
 }
 
@@ -30,9 +26,10 @@ Symbol<T>& Grammar<T>::add_symbol_to_dict(const std::string& sym, int lbp) {
         s.lbp = s.lbp > lbp ? s.lbp : lbp;
         return s;
     } else {
-        Symbol<T> s(sym, lbp);
-        symbols[sym] = s;
-        return symbols[sym];
+        Symbol<T>& s = symbols[sym];
+        s.id = sym;
+        s.lbp = lbp;
+        return s;
     }
 }      
 
@@ -79,26 +76,29 @@ Symbol<T>& Grammar<T>::infix_r(const std::string& op, int binding_power,
 template <typename T>
 Symbol<T>& Grammar<T>::brackets(const std::string& ob, const std::string& cb, 
         int binding_power, std::function<T(T)> selector) {
-    Symbol<T>& open_sym = add_symbol_to_dict(ob, binding_power);
     /* Symbol<T>& close_sym = */ add_symbol_to_dict(cb, 0);
+    return brackets(ob, binding_power, 
+                    [cb](PrattParser<T>& p) { p.advance(cb); }, selector);
+}
+
+template <typename T>
+Symbol<T>& Grammar<T>::brackets(const std::string& ob, int binding_power, 
+        std::function<void(PrattParser<T>&)> close, std::function<T(T)> selector) {
+    Symbol<T>& open_sym = add_symbol_to_dict(ob, binding_power);
     if (!selector) selector = [](T val) -> T { return val; };
-    open_sym.nud = [cb, selector](PrattParser<T>& p) -> T {
-            T val = p.parse(0);
-            p.advance(cb);
-            return selector(val);
-    };
+    open_sym.nud = Combinator<T>{Combinator<T>::BRACKETS, nullptr, 0, 
+                                 selector, nullptr, close};
     return open_sym;
 }
 
 template <typename T>
-T Grammar<T>::parse(const std::string& text) const {
+T Grammar<T>::parse(StringRef text) const {
     return PrattParser<T>(text, symbols).parse();
 }
 
 template <typename T>
 T Grammar<T>::parse(const char* text) const {
-    std::string str(text);
-    return parse(str);
+    return parse(StringRef(text));
 }
 
 template <typename T>
@@ -106,8 +106,14 @@ const SymbolDict<T>& Grammar<T>::get_symbols() const {
     return symbols;
 }
 
+template <typename T>
+void Grammar<T>::set_case_sensitive(bool sensitive) {
+    symbols.set_case_sensitive(sensitive);
+}
+
 /* functions for changing the behaviour of a particular symbol */
-/* Notice: this function takes sym.lbp because it can't know about
+/* Notice: this function takes the lbp of sym in the current mode 
+       (see PrattParser::lbp_of) because it can't know about
        binding_powers implicitly stored in led or nud of this symbol.
        Therefore it shouldn't be used with symbols which contain
        different lbps in nud and led. The reason is that it can change 
@@ -115,7 +121,7 @@ const SymbolDict<T>& Grammar<T>::get_symbols() const {
        Although, the function is useful when lbp of a symbol is constant. */
 template <typename T> template <typename _Semantics> void 
 Grammar<T>::set_behaviour(Symbol<T>& sym, typename _Semantics::handler_type func) {
-    set_behaviour_helper(_Semantics(), sym, func);
+    assign(sym, make_behaviour(_Semantics(), sym, func));
 }
 
 /* this version of 'set_behaviour' allows to specify 'rbp' used by
@@ -123,121 +129,102 @@ Grammar<T>::set_behaviour(Symbol<T>& sym, typename _Semantics::handler_type func
         mentioned above */
 template <typename T> template <typename _Semantics> void 
 Grammar<T>::set_behaviour(Symbol<T>& sym, int rbp, typename _Semantics::handler_type func) {
-    set_behaviour_helper(_Semantics(), sym, func, rbp);
+    assign(sym, make_behaviour(_Semantics(), sym, func, rbp));
 }
 
-template <typename T> template <typename _Semantics>
-Grammar<T>::behaviour_guard<_Semantics>::behaviour_guard
-                (Symbol<T>& sym, typename _Semantics::handler_type func) : 
-                    old_func(Grammar<T>::get_handler<typename _Semantics::func_type>(sym)), 
-                    sym(sym) {
-#ifdef DEBUG
-        std::cout << "Behaviour guard construction for " << sym.id << std::endl;
-#endif
-        set_behaviour<_Semantics>(sym, func);
+template <typename T> template <typename _Semantics> void 
+Grammar<T>::set_behaviour(Mode<T>& mode, const Symbol<T>& sym, 
+                          typename _Semantics::handler_type func) {
+    assign(mode, sym, make_behaviour(_Semantics(), sym, func));
 }
 
-template <typename T> template <typename _Semantics>
-Grammar<T>::behaviour_guard<_Semantics>::behaviour_guard
-                (Symbol<T>& sym, int rbp, typename _Semantics::handler_type func) : 
-                    old_func(Grammar<T>::get_handler<typename _Semantics::func_type>(sym)),
-                    sym(sym) {
-#ifdef DEBUG
-    std::cout << "Behaviour guard construction for " << sym.id << std::endl;
-#endif
-    set_behaviour<_Semantics>(sym, rbp, func);
+template <typename T> template <typename _Semantics> void 
+Grammar<T>::set_behaviour(Mode<T>& mode, const Symbol<T>& sym, int rbp, 
+                          typename _Semantics::handler_type func) {
+    assign(mode, sym, make_behaviour(_Semantics(), sym, func, rbp));
 }
 
-template <typename T> template <typename _Semantics>
-Grammar<T>::behaviour_guard<_Semantics>::~behaviour_guard() {
-#ifdef DEBUG
-    std::cout << "Behaviour guard destruction for " << sym.id << std::endl;
-#endif
-    restore_behaviour<typename _Semantics::func_type>(sym, old_func);
+template <typename T>
+Grammar<T>::mode_guard::mode_guard(PrattParser<T>& parser, const Mode<T>& mode) :
+    parser(parser), mode(mode) {
+    parser.enter(mode);
 }
 
-__DEFINE_GRAMMAR_GUARD__(lbp, int)
-__DEFINE_GRAMMAR_GUARD__(nud, typename Prefix::func_type)
-__DEFINE_GRAMMAR_GUARD__(led, typename LeftAssociative::func_type)
-
-/************************ helper functions *****************************/
-
-template <typename T> template <typename _Func> _Func&&
-Grammar<T>::get_handler(Symbol<T>& sym) {
-    return get_handler_helper(type<_Func>(), sym); }
-
-template <typename T> std::function<T(PrattParser<T>&)>&&
-Grammar<T>::get_handler_helper
-    (type<std::function<T(PrattParser<T>&)>>, Symbol<T>& sym) {
-         return std::move(sym.nud); }
-
-template <typename T> std::function<T(PrattParser<T>&, T)>&&
-Grammar<T>::get_handler_helper
-    (type<std::function<T(PrattParser<T>&, T)>>, Symbol<T>& sym) {
-         return std::move(sym.led); }
-
-/***********************************************************************/
-
-template <typename T> template <typename _Func> void 
-Grammar<T>::restore_behaviour(Symbol<T>& sym, _Func& f) {
-    restore_behaviour_helper(type<_Func>(), sym, f);
+template <typename T>
+Grammar<T>::mode_guard::~mode_guard() {
+    parser.leave(mode);
 }
 
-template <typename T> void 
-Grammar<T>::restore_behaviour_helper
-    (type<std::function<T(PrattParser<T>&)>>, Symbol<T>& sym, 
-          std::function<T(PrattParser<T>&)>& f) {
-               sym.nud = std::move(f); }
-
-template <typename T> void 
-Grammar<T>::restore_behaviour_helper
-    (type<std::function<T(PrattParser<T>&, T)>>, Symbol<T>& sym, 
-          std::function<T(PrattParser<T>&, T)>& f) {
-               sym.led = std::move(f); }
-
-/**********************************************************************/
-
-template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::Prefix, 
-        Symbol<T>& sym, std::function<T(T)> f) {
-        sym.nud = [&sym, f](PrattParser<T>& p) -> T {
-            return f(p.parse(sym.lbp)); }; }
+/************************ helper functions *****************************/
 
 template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::Prefix, 
-        Symbol<T>& sym, std::function<T(T)> f, int rbp) {
-        sym.nud = [rbp, f](PrattParser<T>& p) -> T {
-            return f(p.parse(rbp)); }; }
+Grammar<T>::assign(Symbol<T>& sym, typename Prefix::func_type f) {
+    sym.nud = std::move(f); }
 
 template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::Postfix, 
-        Symbol<T>& sym, std::function<T(T)> f, int) {
-        sym.led = [f](PrattParser<T>&, T left) -> T {
-            return f(left); }; }
+Grammar<T>::assign(Symbol<T>& sym, typename Postfix::func_type f) {
+    sym.led = std::move(f); }
 
 template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::LeftAssociative, 
-        Symbol<T>& sym, std::function<T(T, T)> f) {
-        sym.led = [&sym, f](PrattParser<T>& p, T left) -> T {
-            return f(left, p.parse(sym.lbp)); }; }
+Grammar<T>::assign(Mode<T>& mode, const Symbol<T>& sym, typename Prefix::func_type f) {
+    mode.set_nud(sym, std::move(f)); }
 
 template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::LeftAssociative, 
-        Symbol<T>& sym, std::function<T(T, T)> f, int rbp) {
-        sym.led = [rbp, f](PrattParser<T>& p, T left) -> T {
-            return f(left, p.parse(rbp)); }; }
+Grammar<T>::assign(Mode<T>& mode, const Symbol<T>& sym, typename Postfix::func_type f) {
+    mode.set_led(sym, std::move(f)); }
 
-template <typename T> void
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::RightAssociative, 
-        Symbol<T>& sym, std::function<T(T, T)> f) {
-        sym.led = [&sym, f](PrattParser<T>&p, T left) -> T {
-            return f(left, p.parse(sym.lbp - 1)); }; }
+/**********************************************************************/
 
-template <typename T> void 
-Grammar<T>::set_behaviour_helper (typename Grammar<T>::RightAssociative, 
-        Symbol<T>& sym, std::function<T(T, T)> f, int rbp) {
-        sym.led = [rbp, f](PrattParser<T>&p, T left) -> T {
-            return f(left, p.parse(rbp - 1)); }; }
+/* The standard combinators are Combinator objects, which PrattParser
+   runs without recursion; right associativity is the binding power 
+   of the right operand being one less than that of the operator. 
+   A List is right-associative too, but its handler is called once 
+   for the whole sequence. */
+
+template <typename T> typename Grammar<T>::Prefix::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::Prefix, 
+        const Symbol<T>& sym, std::function<T(T)> f) {
+        return Combinator<T>{Combinator<T>::PREFIX, &sym, 0, f, nullptr, nullptr}; }
+
+template <typename T> typename Grammar<T>::Prefix::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::Prefix, 
+        const Symbol<T>&, std::function<T(T)> f, int rbp) {
+        return Combinator<T>{Combinator<T>::PREFIX, nullptr, rbp, f, nullptr, nullptr}; }
+
+template <typename T> typename Grammar<T>::Postfix::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::Postfix, 
+        const Symbol<T>&, std::function<T(T)> f, int) {
+        return Combinator<T>{Combinator<T>::POSTFIX, nullptr, 0, f, nullptr, nullptr}; }
+
+template <typename T> typename Grammar<T>::LeftAssociative::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::LeftAssociative, 
+        const Symbol<T>& sym, std::function<T(T, T)> f) {
+        return Combinator<T>{Combinator<T>::INFIX, &sym, 0, nullptr, f, nullptr}; }
+
+template <typename T> typename Grammar<T>::LeftAssociative::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::LeftAssociative, 
+        const Symbol<T>&, std::function<T(T, T)> f, int rbp) {
+        return Combinator<T>{Combinator<T>::INFIX, nullptr, rbp, nullptr, f, nullptr}; }
+
+template <typename T> typename Grammar<T>::RightAssociative::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::RightAssociative, 
+        const Symbol<T>& sym, std::function<T(T, T)> f) {
+        return Combinator<T>{Combinator<T>::INFIX, &sym, -1, nullptr, f, nullptr}; }
+
+template <typename T> typename Grammar<T>::RightAssociative::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::RightAssociative, 
+        const Symbol<T>&, std::function<T(T, T)> f, int rbp) {
+        return Combinator<T>{Combinator<T>::INFIX, nullptr, rbp - 1, nullptr, f, nullptr}; }
+
+template <typename T> typename Grammar<T>::List::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::List, 
+        const Symbol<T>& sym, std::function<T(std::vector<T>&&)> f) {
+        return Combinator<T>{Combinator<T>::LIST, &sym, -1, nullptr, nullptr, nullptr, f}; }
+
+template <typename T> typename Grammar<T>::List::func_type
+Grammar<T>::make_behaviour (typename Grammar<T>::List, 
+        const Symbol<T>&, std::function<T(std::vector<T>&&)> f, int rbp) {
+        return Combinator<T>{Combinator<T>::LIST, nullptr, rbp - 1, nullptr, nullptr, nullptr, f}; }
 
 } // namespace
 
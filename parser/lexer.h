@@ -0,0 +1,131 @@
+#ifndef PARSER_LEXER_H
+#define PARSER_LEXER_H
+
+#include "forward.h"
+#include "string_ref.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace lexer {
+    /// Converts ASCII letters to lower case, leaves other characters as they are
+    inline char fold_case(char c) {
+        return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+    }
+}
+
+/// Perfect hash table of keywords used by Lexer in reserved-word mode.
+/** The seed and the size of the table are chosen at construction 
+ *  so that no two keywords collide. Therefore a lookup costs one hash 
+ *  computation and at most one string comparison.
+ */
+template <typename T>
+class KeywordTable {
+        struct Entry {
+            const Symbol<T>* symbol; ///< nullptr in empty slots
+            uint32_t index;          ///< index of #symbol in the symbol table of Lexer
+        };
+
+        std::vector<Entry> table; ///< size is a power of two
+        uint32_t seed;
+        uint32_t shift;        ///< hash is reduced to an index by taking its high bits
+        size_t min_length;
+        size_t max_length;
+        bool fold; ///< compare keywords case-insensitively
+
+        static uint32_t hash(uint32_t seed, const char* s, size_t len, bool fold);
+
+    public:
+        static const uint32_t NOT_FOUND = 0xFFFFFFFFu;
+
+        KeywordTable();
+        /// \a keywords are indices of the keywords in \a symbols
+        KeywordTable(const std::vector<const Symbol<T>*>& symbols,
+                     const std::vector<uint32_t>& keywords,
+                     bool case_sensitive = true);
+
+        /// Returns the index of the keyword equal to [s, s + len) or #NOT_FOUND.
+        uint32_t find(const char* s, size_t len) const;
+};
+
+/// Compiled form of a SymbolDict used by Token::iterator.
+/** Symbols without a scanner (i.e. fixed strings like "begin" or ":=")
+ *  are merged into a trie, so that matching all of them at some position
+ *  costs a single walk over the input instead of a comparison per symbol.
+ *  Symbols with a scanner are tried one by one, but only those which 
+ *  may start with the current character (see Symbol::set_scanner).
+ *
+ *  The result is the same as that of scanning every symbol in turn:
+ *  the longest match wins, ties are broken by the highest Symbol#lbp
+ *  and then by the order of identifiers in SymbolDict.
+ *
+ *  The exception is reserved-word mode (see Symbol::reserve_keywords).
+ *  Fixed strings which the identifier scanner matches entirely are
+ *  keywords. They are not put into the trie; instead, the text scanned 
+ *  as identifier is looked up in a KeywordTable, and if it is there, 
+ *  the keyword is used in place of the identifier regardless of lbp.
+ *
+ *  In a case-insensitive dictionary letters of the trie have edges 
+ *  for both cases, and keywords are hashed and compared with their 
+ *  letters converted to lower case; the input itself is never copied.
+ */
+template <typename T>
+class Lexer {
+        struct Edge {
+            unsigned char c;
+            uint32_t target;
+        };
+
+        struct Node {
+            uint32_t symbol;     ///< symbol whose id ends at this node or NO_SYMBOL
+            uint32_t first_edge; ///< index of the first outgoing edge in #edges
+            uint32_t edge_count;
+        };
+
+        static const uint32_t NO_NODE = 0xFFFFFFFFu;
+
+        /// All symbols of the dictionary in its order; other members refer to them by index
+        std::vector<const Symbol<T>*> symbols;
+
+        std::vector<Node> nodes; ///< nodes[0] is the root
+        std::vector<Edge> edges; ///< outgoing edges of each node, sorted by character
+        uint32_t root_edges[256]; ///< transitions from the root, indexed by character
+
+        /** Symbols having a scanner, grouped by the first character
+         *  of tokens they can produce: those which may start with 
+         *  character c are scanners[scanners_begin[c] .. scanners_begin[c + 1])
+         */
+        std::vector<uint32_t> scanners;
+        uint32_t scanners_begin[257];
+
+        uint32_t identifier; ///< symbol which reserves keywords or NO_SYMBOL
+        KeywordTable<T> keywords;
+
+        bool case_sensitive_;
+
+        uint32_t child(uint32_t node, unsigned char c) const;
+
+    public:
+        static const uint32_t NO_SYMBOL = 0xFFFFFFFFu;
+
+        /// Builds the trie from all symbols of \a symbols.
+        Lexer(const SymbolDict<T>& symbols);
+
+        /** Returns the index of the symbol matching \a str at \a pos 
+         *  (or NO_SYMBOL if there is no such symbol) and sets \a end 
+         *  to the position after the match.
+         */
+        uint32_t match_index(StringRef str, size_t pos, size_t& end) const;
+
+        /// Same as #match_index but returns the symbol itself or nullptr.
+        const Symbol<T>* match(StringRef str, size_t pos, size_t& end) const;
+
+        /// Symbols of the dictionary indexed as in #match_index
+        const std::vector<const Symbol<T>*>& symbol_table() const;
+
+        /// See SymbolDict::set_case_sensitive
+        bool case_sensitive() const;
+};
+
+#endif
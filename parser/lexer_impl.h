@@ -0,0 +1,263 @@
+#ifndef PARSER_LEXER_IMPL_H
+#define PARSER_LEXER_IMPL_H
+
+#include "lexer.h"
+
+#include <map>
+#include <set>
+#include <limits>
+#include <algorithm>
+
+/* KeywordTable functions */
+
+template <typename T> const uint32_t KeywordTable<T>::NOT_FOUND;
+
+template <typename T>
+uint32_t KeywordTable<T>::hash(uint32_t seed, const char* s, size_t len, bool fold) {
+    /* FNV-1a with a variable offset basis */
+    uint32_t h = seed ^ (static_cast<uint32_t>(len) * 0x9E3779B1u);
+    for (size_t i = 0; i < len; ++i) {
+        h ^= static_cast<unsigned char>(fold ? lexer::fold_case(s[i]) : s[i]);
+        h *= 0x01000193u;
+    }
+    return h ^ (h >> 15);
+}
+
+template <typename T>
+KeywordTable<T>::KeywordTable() : table(1), seed(0), shift(32), 
+                                  min_length(1), max_length(0), fold(false) {} // finds nothing
+
+template <typename T>
+KeywordTable<T>::KeywordTable(const std::vector<const Symbol<T>*>& symbols,
+                              const std::vector<uint32_t>& keywords,
+                              bool case_sensitive) : 
+    table(1), seed(0), shift(32),
+    min_length(std::numeric_limits<size_t>::max()), max_length(0),
+    fold(!case_sensitive)
+{
+    if (keywords.empty())
+        return; // find() never gets to hashing
+
+    for (auto it = keywords.cbegin(); it != keywords.cend(); ++it) {
+        min_length = std::min(min_length, symbols[*it] -> id.length());
+        max_length = std::max(max_length, symbols[*it] -> id.length());
+    }
+
+    /* start with a table at least twice as big as the number of keywords
+       and double it each time many seeds in a row fail */
+    uint32_t bits = 1;
+    while ((1u << bits) < 2 * keywords.size())
+        ++bits;
+
+    static const uint32_t SEEDS_PER_SIZE = 1000;
+    const Entry empty = { nullptr, NOT_FOUND };
+    for ( ; ; ++bits) {
+        shift = 32 - bits;
+        for (seed = 1; seed <= SEEDS_PER_SIZE; ++seed) {
+            table.assign(1u << bits, empty);
+            bool collision = false;
+            for (auto it = keywords.cbegin(); it != keywords.cend(); ++it) {
+                const std::string& id = symbols[*it] -> id;
+                uint32_t index = hash(seed, id.data(), id.length(), fold) >> shift;
+                if (table[index].symbol != nullptr) {
+                    collision = true;
+                    break;
+                }
+                table[index].symbol = symbols[*it];
+                table[index].index = *it;
+            }
+            if (!collision)
+                return;
+        }
+    }
+}
+
+template <typename T>
+uint32_t KeywordTable<T>::find(const char* s, size_t len) const {
+    if (len < min_length || len > max_length)
+        return NOT_FOUND;
+    const Entry& kw = table[hash(seed, s, len, fold) >> shift];
+    if (kw.symbol == nullptr || kw.symbol -> id.length() != len)
+        return NOT_FOUND;
+    const char* id = kw.symbol -> id.data();
+    if (fold) {
+        for (size_t i = 0; i < len; ++i) {
+            if (lexer::fold_case(s[i]) != lexer::fold_case(id[i]))
+                return NOT_FOUND;
+        }
+        return kw.index;
+    }
+    return std::equal(s, s + len, id) ? kw.index : NOT_FOUND;
+}
+
+/* Lexer functions */
+
+template <typename T> const uint32_t Lexer<T>::NO_NODE;
+template <typename T> const uint32_t Lexer<T>::NO_SYMBOL;
+
+template <typename T>
+Lexer<T>::Lexer(const SymbolDict<T>& dict) : 
+    identifier(NO_SYMBOL), case_sensitive_(dict.is_case_sensitive()) 
+{
+    /* the trie is first built with maps for simplicity
+       and then flattened into #nodes and #edges */
+    std::vector<std::map<unsigned char, uint32_t>> children(1);
+    std::vector<uint32_t> terminals(1, NO_SYMBOL);
+    std::vector<uint32_t> all_scanners;
+    std::vector<uint32_t> reserved;
+    std::set<std::string> reserved_ids;
+
+    for (auto it = dict.cbegin(); it != dict.cend(); ++it) {
+        const Symbol<T>& sym = it -> second;
+        if (sym.has_scanner() && sym.reserves_keywords() && identifier == NO_SYMBOL)
+            identifier = symbols.size();
+        symbols.push_back(&sym);
+    }
+
+    for (uint32_t index = 0; index < symbols.size(); ++index) {
+        const Symbol<T>& sym = *symbols[index];
+        if (sym.has_scanner()) {
+            all_scanners.push_back(index);
+            continue;
+        }
+        if (sym.id.empty())
+            continue; // can't match anything
+        if (identifier != NO_SYMBOL && 
+                symbols[identifier] -> may_start_with(sym.id[0]) &&
+                symbols[identifier] -> scan(sym.id, 0) == sym.id.length()) {
+            std::string key = sym.id;
+            if (!case_sensitive_)
+                std::transform(key.begin(), key.end(), key.begin(), lexer::fold_case);
+            if (reserved_ids.insert(key).second) // ids may coincide if case is ignored
+                reserved.push_back(index);
+            continue;
+        }
+        uint32_t node = 0;
+        for (size_t i = 0; i < sym.id.length(); ++i) {
+            unsigned char c = case_sensitive_ ? sym.id[i] : lexer::fold_case(sym.id[i]);
+            auto next = children[node].find(c);
+            if (next != children[node].end()) {
+                node = next -> second;
+            } else {
+                uint32_t new_node = children.size();
+                children[node][c] = new_node;
+                if (!case_sensitive_ && c >= 'a' && c <= 'z')
+                    children[node][c - ('a' - 'A')] = new_node;
+                children.push_back(std::map<unsigned char, uint32_t>());
+                terminals.push_back(NO_SYMBOL);
+                node = new_node;
+            }
+        }
+        if (terminals[node] == NO_SYMBOL) // ids may coincide if case is ignored
+            terminals[node] = index;
+    }
+
+    nodes.resize(children.size());
+    for (size_t i = 0; i < children.size(); ++i) {
+        nodes[i].symbol = terminals[i];
+        nodes[i].first_edge = edges.size();
+        nodes[i].edge_count = children[i].size();
+        for (auto it = children[i].cbegin(); it != children[i].cend(); ++it) {
+            Edge e = { it -> first, it -> second };
+            edges.push_back(e);
+        }
+    }
+
+    for (size_t c = 0; c < 256; ++c)
+        root_edges[c] = NO_NODE;
+    for (auto it = children[0].cbegin(); it != children[0].cend(); ++it)
+        root_edges[it -> first] = it -> second;
+
+    for (size_t c = 0; c < 256; ++c) {
+        scanners_begin[c] = scanners.size();
+        for (auto it = all_scanners.cbegin(); it != all_scanners.cend(); ++it) {
+            if (symbols[*it] -> may_start_with(c))
+                scanners.push_back(*it);
+        }
+    }
+    scanners_begin[256] = scanners.size();
+
+    keywords = KeywordTable<T>(symbols, reserved, case_sensitive_);
+}
+
+template <typename T>
+uint32_t Lexer<T>::child(uint32_t node, unsigned char c) const {
+    const Edge* e = &edges[nodes[node].first_edge];
+    const Edge* last = e + nodes[node].edge_count;
+    for ( ; e != last && e -> c <= c; ++e) {
+        if (e -> c == c)
+            return e -> target;
+    }
+    return NO_NODE;
+}
+
+template <typename T>
+uint32_t Lexer<T>::match_index(StringRef str, size_t pos, size_t& end) const {
+    uint32_t match = NO_SYMBOL;
+    size_t len = str.length();
+    end = pos;
+
+    if (pos >= len)
+        return match;
+
+    unsigned char first = str[pos];
+
+    /* the deepest terminal node on the path is the longest fixed-string match */
+    uint32_t node = root_edges[first];
+    size_t i = pos + 1;
+    while (node != NO_NODE) {
+        if (nodes[node].symbol != NO_SYMBOL) {
+            match = nodes[node].symbol;
+            end = i;
+        }
+        if (i >= len)
+            break;
+        node = child(node, str[i++]);
+    }
+
+    auto it = scanners.cbegin() + scanners_begin[first];
+    auto last = scanners.cbegin() + scanners_begin[first + 1];
+    for ( ; it != last; ++it) {
+        uint32_t index = *it;
+        size_t p = symbols[index] -> scan(str, pos);
+        if (index == identifier && p > pos) {
+            uint32_t kw = keywords.find(str.data() + pos, p - pos);
+            if (kw != KeywordTable<T>::NOT_FOUND)
+                index = kw;
+        }
+        if (p > end) {
+            match = index;
+            end = p;
+            continue;
+        }
+        /* longest match with highest precedence;
+           the remaining ties are resolved as if the symbols
+           were scanned in the order of SymbolDict */
+        if (match != NO_SYMBOL && p == end) {
+            const Symbol<T>* sym = symbols[index];
+            const Symbol<T>* best = symbols[match];
+            if (sym -> lbp > best -> lbp || 
+                    (sym -> lbp == best -> lbp && index < match))
+                match = index;
+        }
+    }
+    return match;
+}
+
+template <typename T>
+const Symbol<T>* Lexer<T>::match(StringRef str, size_t pos, size_t& end) const {
+    uint32_t index = match_index(str, pos, end);
+    return index == NO_SYMBOL ? nullptr : symbols[index];
+}
+
+template <typename T>
+const std::vector<const Symbol<T>*>& Lexer<T>::symbol_table() const {
+    return symbols;
+}
+
+template <typename T>
+bool Lexer<T>::case_sensitive() const {
+    return case_sensitive_;
+}
+
+#endif
@@ -0,0 +1,67 @@
+#ifndef PARSER_LINE_INDEX_H
+#define PARSER_LINE_INDEX_H
+
+#include "string_ref.h"
+
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+struct SourcePosition {
+    size_t position;
+    size_t line;   ///< one-indexed
+    size_t column; ///< one-indexed
+};
+
+/// Maps positions in a string to lines and columns.
+/** Offsets of line beginnings are collected on the first lookup 
+ *  (newlines are searched with memchr, which is vectorized 
+ *  in common C libraries), after that a lookup is a binary search.
+ *  Lexing thus doesn't need to track lines at all.
+ *
+ *  When the string is never in memory as a whole (see ChunkedReader), 
+ *  the index is default-constructed and fed with consecutive pieces 
+ *  of it instead.
+ */
+class LineIndex {
+        StringRef str; ///< the whole string unless the index is fed by #append
+        mutable std::vector<size_t> line_starts; ///< empty until the first lookup
+
+        static void add_lines(std::vector<size_t>& line_starts, StringRef s, size_t offset) {
+            const char* data = s.data();
+            size_t len = s.length();
+            for (const void* p = memchr(data, '\n', len); p != nullptr; ) {
+                size_t next = static_cast<const char*>(p) - data + 1;
+                line_starts.push_back(offset + next);
+                p = next < len ? memchr(data + next, '\n', len - next) : nullptr;
+            }
+        }
+
+    public:
+        explicit LineIndex(StringRef str) : str(str) {}
+
+        /// Index to be fed by #append
+        LineIndex() : line_starts(1, 0) {}
+
+        /// Adds lines of \a piece which begins at \a offset right after the previous piece.
+        void append(StringRef piece, size_t offset) {
+            add_lines(line_starts, piece, offset);
+        }
+
+        /// Returns line and column of \a offset; O(log n) once the index is built.
+        SourcePosition position(size_t offset) const {
+            if (line_starts.empty()) {
+                line_starts.reserve(std::count(str.begin(), str.end(), '\n') + 1);
+                line_starts.push_back(0);
+                add_lines(line_starts, str, 0);
+            }
+            SourcePosition sp;
+            sp.position = offset;
+            auto it = std::upper_bound(line_starts.begin(), line_starts.end(), offset);
+            sp.line = it - line_starts.begin();
+            sp.column = offset - *(it - 1) + 1;
+            return sp;
+        }
+};
+
+#endif
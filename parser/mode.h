@@ -0,0 +1,49 @@
+#ifndef PARSER_MODE_H
+#define PARSER_MODE_H
+
+#include "forward.h"
+
+#include <functional>
+#include <vector>
+
+/// Changes of lbp, nud and led of some symbols which are made together.
+/** Symbols often behave differently in some context, e.g. ',' separates
+ *  identifiers in a declaration and arguments in a function call.
+ *  Such a context is described by a mode. Modes are built along with
+ *  the grammar and shall not be changed after parsing has begun.
+ *
+ *  Handlers enter a mode with PrattParser::enter (usually through
+ *  Grammar::mode_guard), which puts its changes on top of the current
+ *  behaviour of the symbols, and leave it with PrattParser::leave.
+ *  Neither symbols nor modes are modified by that: the parser only
+ *  repoints its table of behaviours at the ones stored here.
+ */
+template <typename T>
+class Mode {
+    public:
+        typedef std::function<T(PrattParser<T>&)> NudType;
+        typedef std::function<T(PrattParser<T>&, T)> LedType;
+
+        /// What the mode changes in one symbol
+        struct Change {
+            const Symbol<T>* symbol;
+            bool sets_lbp;
+            int lbp;
+            NudType nud; ///< isn't changed if empty
+            LedType led; ///< isn't changed if empty
+        };
+
+        Mode<T>& set_lbp(const Symbol<T>& sym, int lbp);
+        Mode<T>& set_nud(const Symbol<T>& sym, NudType nud);
+        Mode<T>& set_led(const Symbol<T>& sym, LedType led);
+
+        /// At most one change per symbol
+        const std::vector<Change>& changes() const;
+
+    private:
+        Change& change(const Symbol<T>& sym);
+
+        std::vector<Change> changes_;
+};
+
+#endif
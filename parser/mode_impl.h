@@ -0,0 +1,46 @@
+#ifndef PARSER_MODE_IMPL_H
+#define PARSER_MODE_IMPL_H
+
+#include "mode.h"
+
+#include <utility>
+
+template <typename T>
+typename Mode<T>::Change& Mode<T>::change(const Symbol<T>& sym) {
+    for (size_t i = 0; i < changes_.size(); ++i)
+        if (changes_[i].symbol == &sym)
+            return changes_[i];
+    Change c;
+    c.symbol = &sym;
+    c.sets_lbp = false;
+    c.lbp = 0;
+    changes_.push_back(std::move(c));
+    return changes_.back();
+}
+
+template <typename T>
+Mode<T>& Mode<T>::set_lbp(const Symbol<T>& sym, int lbp) {
+    Change& c = change(sym);
+    c.sets_lbp = true;
+    c.lbp = lbp;
+    return *this;
+}
+
+template <typename T>
+Mode<T>& Mode<T>::set_nud(const Symbol<T>& sym, NudType nud) {
+    change(sym).nud = std::move(nud);
+    return *this;
+}
+
+template <typename T>
+Mode<T>& Mode<T>::set_led(const Symbol<T>& sym, LedType led) {
+    change(sym).led = std::move(led);
+    return *this;
+}
+
+template <typename T>
+const std::vector<typename Mode<T>::Change>& Mode<T>::changes() const {
+    return changes_;
+}
+
+#endif
@@ -0,0 +1,37 @@
+#ifndef PARSER_PARSE_ERROR_H
+#define PARSER_PARSE_ERROR_H
+
+#include <string>
+#include <sstream>
+#include <stdexcept>
+#include <cstddef>
+
+/// Thrown by PrattParser when a token can't be used where it is.
+/** what() tells the line of the token; #description and #position
+ *  are for those who report errors their own way, e.g. collecting
+ *  several of them.
+ */
+class ParseError : public std::runtime_error {
+        std::string description_;
+        size_t position_;
+
+        static std::string message(const std::string& description, size_t line) {
+            std::stringstream ss;
+            ss << "parsing error near line " << line << ": " << description;
+            return ss.str();
+        }
+
+    public:
+        /// \a line is that of \a position
+        ParseError(const std::string& description, size_t position, size_t line) :
+            std::runtime_error(message(description, line)),
+            description_(description), position_(position) {}
+
+        /// The message without the line
+        const std::string& description() const { return description_; }
+
+        /// Position of the beginning of the token in the string being parsed
+        size_t position() const { return position_; }
+};
+
+#endif
@@ -2,8 +2,14 @@
 #define PARSER_H
 
 #include "parser_core.h"
+#include "parse_error.h"
 #include "symbol.h"
 #include "token.h"
+#include "token_stream.h"
+#include "token_document.h"
+#include "source.h"
+#include "lexer.h"
+#include "mode.h"
 #include "grammar.h"
 
 #endif
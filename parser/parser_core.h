@@ -2,36 +2,194 @@
 #define PARSER_CORE_H
 
 #include "forward.h"
+#include "line_index.h"
+#include "string_ref.h"
+#include "parse_error.h"
 
 #include <string>
 #include <memory>
+#include <vector>
+#include <functional>
+#include <utility>
 
-struct SourcePosition {
-    size_t position;
-    size_t line;
-    size_t column;
+/// nud or led made by one of the standard combinators of Grammar.
+/** PrattParser recognizes these among nuds and leds of symbols and runs
+ *  them in its own loop: an operator waiting for its right operand is
+ *  kept on a stack in the heap instead of in a native stack frame, so
+ *  nesting of such operators is limited only by memory. Called as
+ *  an ordinary nud or led, a combinator parses its operand recursively.
+ *
+ *  A LIST is a right-associative separator whose operands are gathered
+ *  in one vector while the parser goes along the sequence, so that
+ *  #nary makes one node of them instead of one per separator.
+ */
+template <typename T>
+struct Combinator {
+    enum Kind { PREFIX, POSTFIX, INFIX, BRACKETS, LIST };
+    Kind kind;
+
+    /// If set, the binding power of the right operand is its lbp
+    /// in the current mode plus #rbp
+    const Symbol<T>* sym;
+    int rbp;
+
+    std::function<T(T)> unary;     ///< for PREFIX, POSTFIX and BRACKETS
+    std::function<T(T, T)> binary; ///< for INFIX
+    std::function<void(PrattParser<T>&)> close; ///< consumes the closing bracket
+    std::function<T(std::vector<T>&&)> nary; ///< for LIST, called with all operands
+
+    /// Binding power of the right operand
+    int right_bp(const PrattParser<T>& p) const;
+
+    /// As nud
+    T operator()(PrattParser<T>& p) const;
+    /// As led
+    T operator()(PrattParser<T>& p, T left) const;
 };
 
+/// Top down operator precedence parser.
+/** Tokens are taken either from Token::iterator, which lexes the string
+ *  on the fly, or from a TokenStream prepared in advance.
+ *
+ *  lbp, nud and led of symbols are looked up in a table which belongs
+ *  to the parser, so that handlers may change them for a while
+ *  (see Mode) without modifying the grammar.
+ *
+ *  Operators made by the standard combinators (see Combinator) are
+ *  parsed without recursion; other nuds and leds are called as they are
+ *  and may call #parse recursively.
+ */
 template <typename T>
 class PrattParser {
-        const std::string& str;
-        typename Token<T>::iterator token_iter;
-        std::unique_ptr<Token<T>> token;
-        std::unique_ptr<Token<T>> prev_token;
-        std::unique_ptr<Token<T>> next();
+        StringRef str; ///< empty if the string is read by ChunkedReader
+
+        /// Lexes the string on the fly unless #stream is set
+        std::unique_ptr<typename Token<T>::iterator> token_iter;
+
+        const TokenStream<T>* stream;
+        size_t cursor; ///< index of #token in #stream
+
+        Token<T> token; ///< the next token to be parsed
+
+        bool case_sensitive; ///< see SymbolDict::set_case_sensitive
+
+        LineIndex lines;
+        const LineIndex* line_index; ///< #lines or the one kept by ChunkedReader
+
+        /// What a symbol does in the current mode
+        struct Behaviour {
+            int lbp;
+            const std::function<T(PrattParser<T>&)>* nud;
+            const std::function<T(PrattParser<T>&, T)>* led;
+            const Combinator<T>* nud_combinator; ///< target of #nud if it is one
+            const Combinator<T>* led_combinator; ///< target of #led if it is one
+        };
+
+        /// Indexed by Symbol::index; points to the symbols themselves outside of modes
+        std::vector<Behaviour> behaviour;
+
+        /// Entries of #behaviour replaced by #enter, to be restored by #leave
+        std::vector<std::pair<size_t, Behaviour>> saved;
+
+        /// A combinator waiting for its right operand
+        struct Pending {
+            const Combinator<T>* combinator;
+            int rbp;  ///< binding power the operator itself was parsed with
+            T left;   ///< left operand of an infix operator
+            std::vector<T> operands; ///< of a LIST, but the last one
+        };
+
+        /// Shared by nested calls of #parse, each using the top of it
+        std::vector<Pending> pending;
+
+        /// Called with errors instead of throwing them, see #set_error_handler
+        std::function<void(const ParseError&)> error_handler;
+        bool stopped_;
+        T stop_value_; ///< returned by #parse while stopped
+
+        /// Returns the token after #token
+        Token<T> next();
+        /// Error to be thrown at \a tok
+        ParseError unexpected(const Token<T>& tok, const std::string& description) const;
+        /// Throws \a error, or passes it to #error_handler and makes sure the parser is stopped
+        void fail(const ParseError& error);
+        static Token<T> token_at(const TokenStream<T>& tokens, size_t i);
+        void init_behaviour(const std::vector<const Symbol<T>*>& symbols);
 
     public:
-        PrattParser(const std::string&, const SymbolDict<T>&);
+        PrattParser(StringRef, const SymbolDict<T>&);
+
+        /// Parses the string read by \a reader, see Token::iterator.
+        PrattParser(ChunkedReader& reader, const SymbolDict<T>&);
+
+        /// Parses \a tokens which shall outlive the parser.
+        PrattParser(const TokenStream<T>& tokens);
        
         T parse(int rbp = 0);
         const Token<T>& next_token() const;
+        /** Returns the text of the next token. For tokens of symbols 
+         *  without a scanner that is the id of the symbol. If the grammar
+         *  is case-insensitive, the text of other tokens is converted
+         *  to lower case.
+         */
         const std::string next_token_as_string() const;
+
+        /// Text of the next token as it is in the string, without a copy
+        StringRef next_token_text() const;
+
+        /// Checks whether the next token is produced by \a sym
+        bool next_is(const Symbol<T>& sym) const;
+
+        /// Same as next_token_as_string() == \a text but doesn't copy anything
+        bool next_text_is(StringRef text) const;
+
         PrattParser<T>& advance();
         PrattParser<T>& advance(const std::string& s);
+        PrattParser<T>& advance(const Symbol<T>& sym);
+
+        /** Puts the changes made by \a mode on top of the current behaviour
+         *  of symbols. \a mode shall outlive the parser.
+         *  Costs a few pointer copies and allocates nothing.
+         */
+        void enter(const Mode<T>& mode);
 
+        /// Restores the behaviour changed by \a mode, which shall be the mode entered last.
+        void leave(const Mode<T>& mode);
+
+        /// Left binding power of \a sym in the current mode
+        int lbp_of(const Symbol<T>& sym) const;
+
+        /// nud of \a sym in the current mode, possibly empty
+        const std::function<T(PrattParser<T>&)>& nud_of(const Symbol<T>& sym) const;
+
+        /// led of \a sym in the current mode, possibly empty
+        const std::function<T(PrattParser<T>&, T)>& led_of(const Symbol<T>& sym) const;
+
+        /** Makes the parser pass errors it finds to \a handler instead of
+         *  throwing them; the handler is expected to #stop the parser.
+         */
+        void set_error_handler(const std::function<void(const ParseError&)>& handler);
+
+        /** Makes #parse return \a value at once, without consuming a token,
+         *  #advance do nothing and #next_is and #next_text_is be false, 
+         *  until #resume is called. Handlers then return one after another
+         *  up to the place where the parse goes on after an error, 
+         *  without an exception being thrown.
+         */
+        void stop(T value);
+        void resume();
+        bool stopped() const;
+        /// What #parse returns while stopped
+        const T& stop_value() const;
+
+        /// Position of the next token
         SourcePosition current_position() const;
+
+        /// Line and column of any position in the string being parsed
+        SourcePosition position_of(size_t offset) const;
         
-        const std::string& code() const;
+        /// The string being parsed or, with ChunkedReader, the part of it in memory
+        StringRef code() const;
 };
 
 #endif
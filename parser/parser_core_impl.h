@@ -2,80 +2,377 @@
 #define PARSER_CORE_IMPL_H
 
 #include "parser_core.h"
+#include "lexer.h"
+#include "mode.h"
+
+#include <stdexcept>
+#include <algorithm>
 
 #ifdef DEBUG
 #include <iostream>
 #endif
 
+template <typename T>
+int Combinator<T>::right_bp(const PrattParser<T>& p) const {
+    return sym ? p.lbp_of(*sym) + rbp : rbp;
+}
+
+template <typename T>
+T Combinator<T>::operator()(PrattParser<T>& p) const {
+    T operand = p.parse(right_bp(p));
+    if (kind == BRACKETS)
+        close(p);
+    return unary(std::move(operand));
+}
+
+template <typename T>
+T Combinator<T>::operator()(PrattParser<T>& p, T left) const {
+    if (kind == POSTFIX)
+        return unary(std::move(left));
+    if (kind == LIST) { // the rest of the sequence comes as one operand
+        std::vector<T> operands;
+        operands.push_back(std::move(left));
+        operands.push_back(p.parse(right_bp(p)));
+        return nary(std::move(operands));
+    }
+    return binary(std::move(left), p.parse(right_bp(p)));
+}
+
 template <typename T> 
-std::unique_ptr<Token<T>> PrattParser<T>::next() {
-    std::unique_ptr<Token<T>> tok = *token_iter;
-    ++token_iter;
+Token<T> PrattParser<T>::next() {
+    if (stream) {
+        if (cursor + 1 < stream -> size()) // the end token repeats forever
+            ++cursor;
+        return token_at(*stream, cursor);
+    }
+    Token<T> tok = **token_iter;
+    ++*token_iter;
     return tok;
 }
 
 template <typename T>
-PrattParser<T>::PrattParser(const std::string& str, 
+Token<T> PrattParser<T>::token_at(const TokenStream<T>& tokens, size_t i) {
+    /* like Token::iterator, report an invalid symbol 
+       as soon as it follows the current token */
+    if (i + 1 >= tokens.size() && !tokens.complete())
+        throw std::runtime_error("invalid symbol");
+    size_t start = tokens.start(i);
+    size_t end = start + tokens.length(i);
+    if (tokens.is_literal(i))
+        return Token<T>(tokens.symbol(i), tokens.value(i), start, end);
+    return Token<T>(tokens.symbol(i), start, end);
+}
+
+template <typename T>
+PrattParser<T>::PrattParser(StringRef str, 
             const SymbolDict<T>& symbols) :
-     str(str), token_iter(str, symbols), token(next()) {
+     str(str), token_iter(new typename Token<T>::iterator(str, symbols)), 
+     stream(nullptr), cursor(0), token(next()), 
+     case_sensitive(symbols.is_case_sensitive()), lines(str), line_index(&lines),
+     stopped_(false) {
+    init_behaviour(symbols.lexer().symbol_table());
+}
+
+template <typename T>
+PrattParser<T>::PrattParser(ChunkedReader& reader, 
+            const SymbolDict<T>& symbols) :
+     token_iter(new typename Token<T>::iterator(reader, symbols)), 
+     stream(nullptr), cursor(0), token(next()), 
+     case_sensitive(symbols.is_case_sensitive()), lines(str), 
+     line_index(token_iter -> lines()), stopped_(false) {
+    init_behaviour(symbols.lexer().symbol_table());
+}
+
+template <typename T>
+PrattParser<T>::PrattParser(const TokenStream<T>& tokens) :
+     str(tokens.code()), stream(&tokens), cursor(0), token(token_at(tokens, 0)),
+     case_sensitive(tokens.case_sensitive()), lines(str), line_index(&lines),
+     stopped_(false) {
+    init_behaviour(tokens.symbol_table());
+}
+
+template <typename T>
+void PrattParser<T>::init_behaviour(const std::vector<const Symbol<T>*>& symbols) {
+    size_t size = 0;
+    for (size_t i = 0; i < symbols.size(); ++i)
+        size = std::max(size, symbols[i] -> index() + 1);
+    behaviour.resize(size);
+    for (size_t i = 0; i < symbols.size(); ++i) {
+        const Symbol<T>& sym = *symbols[i];
+        Behaviour b = { sym.lbp, &sym.nud, &sym.led,
+                        sym.nud.template target<Combinator<T>>(),
+                        sym.led.template target<Combinator<T>>() };
+        behaviour[sym.index()] = b;
+    }
+    saved.reserve(64); // deeper nesting of modes is rare
+    pending.reserve(64);
 }
    
 template <typename T>
 T PrattParser<T>::parse(int rbp) {
-    prev_token = std::move(token);
-    token = next();
+    /* Instead of calling nud or led of a combinator, which would parse 
+       the right operand recursively, the operator is pushed on #pending 
+       and the operand is parsed in the same loop; when it is complete 
+       (i.e. the next token doesn't bind tighter than the operator), 
+       the operator is popped and applied to it. */
+    struct Unwind { // drops operators left by an exception or a stop
+        std::vector<Pending>& pending;
+        size_t base;
+        ~Unwind() { pending.erase(pending.begin() + base, pending.end()); }
+    } unwind = { pending, pending.size() };
+
+    /* a token which can't be where it is is reported before it is 
+       consumed, so that recovery from the error may begin at it */
+    T left;
+    for ( ; ; ) {
+        if (stopped_)
+            return stop_value_;
+        if (!token.is_literal() && !*behaviour[token.symbol().index()].nud) {
+            fail(unexpected(token, "expected prefix operator"));
+            return stop_value_;
+        }
+        Token<T> prev = std::move(token);
+        token = next();
+        const Combinator<T>* op = prev.is_literal() ? nullptr 
+                                : behaviour[prev.symbol().index()].nud_combinator;
+        if (op) { // prefix operator or opening bracket
+            pending.push_back(Pending{op, rbp, T()});
+            rbp = op -> right_bp(*this);
+            continue;
+        }
 #ifdef DEBUG
-    std::cout <<  "Calling nud of " << prev_token -> id();
-    std::cout << " (token.lbp = " << token -> lbp() << ", rbp = " << rbp << ")" << std::endl;
+        std::cout <<  "Calling nud of " << prev.id();
+        std::cout << " (token.lbp = " << lbp_of(token.symbol()) << ", rbp = " << rbp << ")" << std::endl;
 #endif
-    T left = prev_token -> nud(*this); /* value for terminals, result of func. call otherwise */
-    while (rbp < token -> lbp()) {
-        prev_token = std::move(token);
-        token = next();
+        left = prev.nud(*this); /* value for terminals, result of func. call otherwise */
+        if (stopped_)
+            return stop_value_;
+
+        for ( ; ; ) {
+            const Combinator<T>* infix = nullptr;
+            while (!infix && rbp < lbp_of(token.symbol())) {
+                if (!*behaviour[token.symbol().index()].led) {
+                    fail(unexpected(token, "unexpected infix/postfix operator"));
+                    return stop_value_;
+                }
+                prev = std::move(token);
+                token = next();
+                op = behaviour[prev.symbol().index()].led_combinator;
+                if (op && (op -> kind == Combinator<T>::INFIX ||
+                           op -> kind == Combinator<T>::LIST)) {
+                    infix = op;
+                } else if (op) {
+                    left = op -> unary(std::move(left));
+                } else {
 #ifdef DEBUG
-        std::cout << "Calling led of " << prev_token -> id();
-        std::cout << " (token.lbp = " << token -> lbp() << ", rbp = " << rbp << ")" << std::endl;
+                    std::cout << "Calling led of " << prev.id();
+                    std::cout << " (token.lbp = " << lbp_of(token.symbol()) << ", rbp = " << rbp << ")" << std::endl;
 #endif
-        left = prev_token -> led(*this, left);
+                    left = prev.led(*this, left);
+                }
+                if (stopped_)
+                    return stop_value_;
+            }
+            if (infix) { // its right operand is parsed next
+                if (infix -> kind != Combinator<T>::LIST) {
+                    pending.push_back(Pending{infix, rbp, std::move(left)});
+                } else {
+                    /* a separator following an operand of the same list 
+                       adds the operand to it; see below for the last one */
+                    if (pending.size() == unwind.base || pending.back().combinator != infix)
+                        pending.push_back(Pending{infix, rbp, T()});
+                    pending.back().operands.push_back(std::move(left));
+                }
+                rbp = infix -> right_bp(*this);
+                break;
+            }
+
+            if (pending.size() == unwind.base)
+                return left;
+            Pending top = std::move(pending.back());
+            pending.pop_back();
+            rbp = top.rbp;
+            switch (top.combinator -> kind) {
+                case Combinator<T>::INFIX:
+                    left = top.combinator -> binary(std::move(top.left), std::move(left));
+                    break;
+                case Combinator<T>::LIST:
+                    top.operands.push_back(std::move(left));
+                    left = top.combinator -> nary(std::move(top.operands));
+                    break;
+                case Combinator<T>::BRACKETS:
+                    top.combinator -> close(*this);
+                    // fall through
+                default:
+                    left = top.combinator -> unary(std::move(left));
+            }
+            if (stopped_)
+                return stop_value_;
+        }
     }
-    return left;
 }
 
 template <typename T>
 const std::string PrattParser<T>::next_token_as_string() const {
-    return str.substr(token -> start_position, token -> length);
+    const Token<T>& tok = next_token();
+    if (!tok.symbol().has_scanner())
+        return tok.id();
+    std::string text = next_token_text().str();
+    if (!case_sensitive)
+        std::transform(text.begin(), text.end(), text.begin(), lexer::fold_case);
+    return text;
+}
+
+template <typename T>
+StringRef PrattParser<T>::next_token_text() const {
+    if (token_iter)
+        return token_iter -> text(token.start_position, token.length);
+    return str.substr(token.start_position, token.length);
+}
+
+template <typename T>
+bool PrattParser<T>::next_is(const Symbol<T>& sym) const {
+    return !stopped_ && &token.symbol() == &sym;
+}
+
+template <typename T>
+bool PrattParser<T>::next_text_is(StringRef text) const {
+    if (stopped_)
+        return false;
+    if (!token.symbol().has_scanner())
+        return StringRef(token.id()) == text;
+    StringRef t = next_token_text();
+    if (case_sensitive)
+        return t == text;
+    return t.size() == text.size() &&
+        std::equal(t.begin(), t.end(), text.begin(), 
+                   [](char a, char b) { return lexer::fold_case(a) == b; });
 }
 
 template <typename T>
 const Token<T>& PrattParser<T>::next_token() const {
-    return *token; // slicing is done here 
+    return token;
 }
 
 template <typename T>
-PrattParser<T>& PrattParser<T>::advance() { token = next(); return *this; }
+PrattParser<T>& PrattParser<T>::advance() {
+    if (!stopped_)
+        token = next();
+    return *this;
+}
 
 template <typename T>
 PrattParser<T>& PrattParser<T>::advance(const std::string& s) {
-    if (next_token_as_string() != s) {
-        throw "unexpected character"; /* FIXME! */
+    if (!stopped_ && !next_text_is(s))
+        fail(unexpected(token, "expected '" + s + "'"));
+    return advance();
+}
+
+template <typename T>
+PrattParser<T>& PrattParser<T>::advance(const Symbol<T>& sym) {
+    if (!stopped_ && !next_is(sym))
+        fail(unexpected(token, "expected '" + sym.id + "'"));
+    return advance();
+}
+
+template <typename T>
+void PrattParser<T>::enter(const Mode<T>& mode) {
+    const std::vector<typename Mode<T>::Change>& changes = mode.changes();
+    for (size_t i = 0; i < changes.size(); ++i) {
+        const typename Mode<T>::Change& change = changes[i];
+        size_t index = change.symbol -> index();
+        Behaviour& b = behaviour[index];
+        saved.push_back(std::make_pair(index, b));
+        if (change.sets_lbp)
+            b.lbp = change.lbp;
+        if (change.nud) {
+            b.nud = &change.nud;
+            b.nud_combinator = change.nud.template target<Combinator<T>>();
+        }
+        if (change.led) {
+            b.led = &change.led;
+            b.led_combinator = change.led.template target<Combinator<T>>();
+        }
     }
-    token = next();
-    return *this;
+}
+
+template <typename T>
+void PrattParser<T>::leave(const Mode<T>& mode) {
+    for (size_t i = mode.changes().size(); i > 0; --i) {
+        behaviour[saved.back().first] = saved.back().second;
+        saved.pop_back();
+    }
+}
+
+template <typename T>
+int PrattParser<T>::lbp_of(const Symbol<T>& sym) const {
+    return behaviour[sym.index()].lbp;
+}
+
+template <typename T>
+const std::function<T(PrattParser<T>&)>& PrattParser<T>::nud_of(const Symbol<T>& sym) const {
+    return *behaviour[sym.index()].nud;
+}
+
+template <typename T>
+const std::function<T(PrattParser<T>&, T)>& PrattParser<T>::led_of(const Symbol<T>& sym) const {
+    return *behaviour[sym.index()].led;
+}
+
+template <typename T>
+ParseError PrattParser<T>::unexpected(const Token<T>& tok, const std::string& description) const {
+    return ParseError(description, tok.start_position, position_of(tok.start_position).line);
+}
+
+template <typename T>
+void PrattParser<T>::fail(const ParseError& error) {
+    if (!error_handler)
+        throw error;
+    error_handler(error);
+    if (!stopped_)
+        stop(T());
+}
+
+template <typename T>
+void PrattParser<T>::set_error_handler(const std::function<void(const ParseError&)>& handler) {
+    error_handler = handler;
+}
+
+template <typename T>
+void PrattParser<T>::stop(T value) {
+    stopped_ = true;
+    stop_value_ = std::move(value);
+}
+
+template <typename T>
+void PrattParser<T>::resume() {
+    stopped_ = false;
+    stop_value_ = T();
+}
+
+template <typename T>
+bool PrattParser<T>::stopped() const {
+    return stopped_;
+}
+
+template <typename T>
+const T& PrattParser<T>::stop_value() const {
+    return stop_value_;
 }
 
 template <typename T>
 SourcePosition PrattParser<T>::current_position() const {
-    SourcePosition sp;
-    const std::unique_ptr<Token<T>>& tok = token ? token : prev_token;
-    sp.position = tok ? tok -> start_position : 0;
-    sp.line = token_iter.current_line();
-    sp.column = sp.position - token_iter.last_new_line() + 1;
-    return sp;
+    return line_index -> position(token.start_position);
+}
+
+template <typename T>
+SourcePosition PrattParser<T>::position_of(size_t offset) const {
+    return line_index -> position(offset);
 }
 
 template <typename T>
-const std::string& PrattParser<T>::code() const {
-    return str;
+StringRef PrattParser<T>::code() const {
+    return token_iter ? token_iter -> code() : str;
 }
 
 #endif
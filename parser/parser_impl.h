@@ -4,6 +4,10 @@
 #include "parser_core_impl.h"
 #include "symbol_impl.h"
 #include "token_impl.h"
+#include "token_stream_impl.h"
+#include "token_document_impl.h"
+#include "lexer_impl.h"
+#include "mode_impl.h"
 #include "grammar_impl.h"
 
 #endif
@@ -0,0 +1,135 @@
+#ifndef PARSER_SOURCE_H
+#define PARSER_SOURCE_H
+
+#include "string_ref.h"
+#include "line_index.h"
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <stdexcept>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Sources of the text to be parsed. A string owned by the caller
+   (std::string, a mapped file or anything else contiguous) is passed
+   as StringRef; a stream too large to be kept in memory is read
+   by ChunkedReader. */
+
+/// Read-only memory mapping of a whole file.
+/** The text is read from the page cache as the lexer goes,
+ *  nothing is copied to the heap. POSIX only.
+ */
+class MappedFile {
+        const char* data_;
+        size_t size_;
+
+    public:
+        /// Throws std::runtime_error if the file can't be mapped
+        explicit MappedFile(const std::string& path) : data_(nullptr), size_(0) {
+            int fd = open(path.c_str(), O_RDONLY);
+            if (fd == -1)
+                throw std::runtime_error("can't open " + path);
+            struct stat st;
+            if (fstat(fd, &st) == -1) {
+                close(fd);
+                throw std::runtime_error("can't stat " + path);
+            }
+            size_ = st.st_size;
+            if (size_ > 0) { // mapping zero bytes is an error
+                void* p = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (p == MAP_FAILED) {
+                    close(fd);
+                    throw std::runtime_error("can't map " + path);
+                }
+                madvise(p, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(p);
+            }
+            close(fd);
+        }
+
+        ~MappedFile() {
+            if (data_ != nullptr)
+                munmap(const_cast<char*>(data_), size_);
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        /// Contents of the file, valid while the object exists
+        StringRef text() const {
+            return data_ != nullptr ? StringRef(data_, size_) : StringRef();
+        }
+};
+
+/// Reads a stream piece by piece, keeping a window of bounded size in memory.
+/** Positions are counted from the beginning of the stream;
+ *  the window holds characters [offset(), offset() + window().size()).
+ *  Token::iterator moves the window as it lexes, so that inputs
+ *  of many gigabytes are lexed without being kept in memory. Lines are
+ *  indexed as the text is read, because it isn't available afterwards;
+ *  that index, a few bytes a line, is all that grows with the input.
+ *  Values of literal tokens are made from the window, so they shall
+ *  own what they keep of their text (see Symbol::set_parser).
+ *
+ *  Only grammars whose token::SkipWhiteSpace needs nothing but 
+ *  the current window can read from it. PascalGrammar can't: 
+ *  it indexes comments and strings of the whole text and lexes it 
+ *  into a TokenStream, whose positions are 32-bit, so Pascal programs
+ *  are parsed from memory or a MappedFile and shall be shorter than 4 GB.
+ */
+class ChunkedReader {
+        std::istream& in;
+        std::vector<char> buffer; ///< its size is the capacity of the window
+        size_t size_;   ///< number of characters in the window
+        size_t offset_; ///< position of buffer[0] in the stream
+        bool at_end_;
+        LineIndex lines_;
+
+    public:
+        explicit ChunkedReader(std::istream& in, size_t window_size = 1 << 20) :
+            in(in), buffer(window_size), size_(0), offset_(0), at_end_(false) {
+            refill(0);
+        }
+
+        ChunkedReader(const ChunkedReader&) = delete;
+        ChunkedReader& operator=(const ChunkedReader&) = delete;
+
+        /// Characters currently in memory; invalidated by #refill
+        StringRef window() const { return StringRef(buffer.data(), size_); }
+
+        /// Position of the first character of #window in the stream
+        size_t offset() const { return offset_; }
+
+        size_t capacity() const { return buffer.size(); }
+
+        /// true if the window reaches the end of the stream
+        bool at_end() const { return at_end_; }
+
+        /// Drops characters before \a keep (a position in the stream) and reads as many as fit.
+        void refill(size_t keep) {
+            if (keep < offset_ || keep > offset_ + size_)
+                throw std::out_of_range("position is not in the window");
+            size_t drop = keep - offset_;
+            std::memmove(buffer.data(), buffer.data() + drop, size_ - drop);
+            size_ -= drop;
+            offset_ = keep;
+            while (!at_end_ && size_ < buffer.size()) {
+                in.read(buffer.data() + size_, buffer.size() - size_);
+                size_t n = in.gcount();
+                lines_.append(StringRef(buffer.data() + size_, n), offset_ + size_);
+                size_ += n;
+                if (!in)
+                    at_end_ = true;
+            }
+        }
+
+        /// Lines of the text read so far
+        const LineIndex& lines() const { return lines_; }
+};
+
+#endif
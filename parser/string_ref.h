@@ -0,0 +1,54 @@
+#ifndef PARSER_STRING_REF_H
+#define PARSER_STRING_REF_H
+
+#include <string>
+#include <cstring>
+#include <algorithm>
+#include <ostream>
+
+/// Non-owning reference to a range of characters (a subset of std::string_view).
+/** The characters shall outlive the reference. 
+ *  Used to look at parts of the parsed string without copying them.
+ */
+class StringRef {
+        const char* data_;
+        size_t size_;
+
+    public:
+        StringRef() : data_(""), size_(0) {}
+        StringRef(const char* s) : data_(s), size_(std::strlen(s)) {}
+        StringRef(const char* s, size_t n) : data_(s), size_(n) {}
+        StringRef(const std::string& s) : data_(s.data()), size_(s.length()) {}
+
+        const char* data() const { return data_; }
+        size_t size() const { return size_; }
+        size_t length() const { return size_; }
+        bool empty() const { return size_ == 0; }
+
+        const char* begin() const { return data_; }
+        const char* end() const { return data_ + size_; }
+        char operator[](size_t i) const { return data_[i]; }
+
+        /// Same as std::string::substr but doesn't copy
+        StringRef substr(size_t pos, size_t n = size_t(-1)) const {
+            pos = std::min(pos, size_);
+            return StringRef(data_ + pos, std::min(n, size_ - pos));
+        }
+
+        /// Copies the characters into a new string
+        std::string str() const { return std::string(data_, size_); }
+};
+
+inline bool operator==(StringRef a, StringRef b) {
+    return a.size() == b.size() && std::equal(a.begin(), a.end(), b.begin());
+}
+
+inline bool operator!=(StringRef a, StringRef b) {
+    return !(a == b);
+}
+
+inline std::ostream& operator<<(std::ostream& out, StringRef s) {
+    return out.write(s.data(), s.size());
+}
+
+#endif
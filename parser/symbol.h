@@ -2,17 +2,22 @@
 #define PARSER_SYMBOL_H
 
 #include "forward.h"
+#include "string_ref.h"
 
 #include <functional>
 #include <string>
 #include <map>
+#include <memory>
+#include <bitset>
+#include <atomic>
+#include <mutex>
 
 /// Represents a particular type of token
 template <typename T>
 class Symbol {
 
-        typedef std::function<size_t(const std::string& str, size_t pos)> ScannerType;
-        typedef std::function<T(const std::string& str, size_t beg, size_t end)> ParserType;
+        typedef std::function<size_t(StringRef str, size_t pos)> ScannerType;
+        typedef std::function<T(StringRef str, size_t beg, size_t end)> ParserType;
 
         /** In case token is literal, used to scan string beginning from given position.
          *
@@ -27,6 +32,16 @@ class Symbol {
          * Returns value of type T.
          */
         ParserType parser;
+
+        /// Characters which tokens produced by #scanner may start with.
+        std::bitset<256> first_chars;
+
+        /// See #reserve_keywords
+        bool keywords;
+
+        size_t index_; ///< see #index
+
+        friend class SymbolDict<T>;
     public:
         /** Unique identifier of the symbol. 
          * Also used if #scanner is not provided.
@@ -43,23 +58,51 @@ class Symbol {
         /** Uses #scanner if provided.
          * Otherwise, scans \a str for \a id.
          */
-        size_t scan(const std::string& str, size_t pos) const;
+        size_t scan(StringRef str, size_t pos) const;
 
         /** Uses #parser if provided.
          * Otherwise throws. Shall be called for literal tokens only.
          */
-        T parse(const std::string& str, size_t beg, size_t end) const;
+        T parse(StringRef str, size_t beg, size_t end) const;
 
         bool has_scanner() const;
         bool has_parser() const;
 
+        /// Returns false if a token of this type surely doesn't start with \a c.
+        bool may_start_with(unsigned char c) const;
+
+        bool reserves_keywords() const;
+
+        /** Position of the symbol in its SymbolDict in order of addition.
+         *  PrattParser looks up the behaviour of the symbol in the current 
+         *  mode by it, see Mode.
+         */
+        size_t index() const;
+
         /** Sets #parser to \a p. Causes instances of PrattParser to treat 
-         * the tokens produced by this symbol as literals 
+         * the tokens produced by this symbol as literals. The string \a p
+         * is given may be a window of the text (see ChunkedReader), so 
+         * the value shall own whatever it keeps of it.
          */
         Symbol<T>& set_parser(const ParserType& p);
 
         /// Sets #scanner to \a s.
         Symbol<T>& set_scanner(const ScannerType& s);
+
+        /** Sets #scanner to \a s and declares that the tokens it scans
+         *  always start with one of \a chars, so that Lexer doesn't call
+         *  it at other positions.
+         */
+        Symbol<T>& set_scanner(const ScannerType& s, const std::string& chars);
+
+        /** Turns on reserved-word mode for a symbol scanning identifiers.
+         *
+         *  Symbols without a scanner whose ids are identifiers themselves
+         *  become keywords: an identifier which is spelled as a keyword 
+         *  is always lexed as that keyword, whatever their lbps are.
+         *  See Lexer.
+         */
+        Symbol<T>& reserve_keywords();
 };
 
 /// Used to store set of symbols.
@@ -74,22 +117,59 @@ class SymbolDict {
     std::string end_id;
 
     MapType dict;
+
+    /// See #set_case_sensitive
+    bool case_sensitive;
+
+    /// Built on demand by #lexer, dropped whenever the dictionary may change
+    mutable std::unique_ptr<Lexer<T>> compiled;
+    /// #compiled once it is built, read without locking
+    mutable std::atomic<const Lexer<T>*> published;
+    /// Held while #compiled is built
+    mutable std::mutex compiling;
+
+    /// Drops #compiled; the dictionary is being changed, so no thread lexes
+    void discard_lexer();
 public:
     typedef typename MapType::iterator iterator;
     typedef typename MapType::const_iterator const_iterator;
 
     SymbolDict(std::string end_id);
+    SymbolDict(const SymbolDict<T>& other);
+    SymbolDict<T>& operator=(const SymbolDict<T>& other);
 
     iterator begin();
     iterator end();
     const_iterator cbegin() const;
     const_iterator cend() const;
     iterator find(const std::string& id);
+    /** Adds a symbol if there is no symbol with \a id.
+     *  Modify the symbol in place rather than assign another one to it,
+     *  which would change its #Symbol::index.
+     */
     Symbol<T>& operator[](const std::string& id);
     const Symbol<T>& end_symbol() const;
 
     /// Returns identifier of end symbol
     const std::string& get_end_id();
+
+    /** If \a sensitive is false, ids of symbols without a scanner 
+     *  match the input regardless of the case of ASCII letters,
+     *  so that e.g. "begin" also matches "BEGIN" and "Begin".
+     *  Scanners are responsible for the case of their tokens themselves.
+     *  Dictionaries are case-sensitive by default.
+     */
+    void set_case_sensitive(bool sensitive);
+    bool is_case_sensitive() const;
+
+    /** Returns the compiled form of the dictionary used by Token::iterator.
+     *
+     *  Non-const accessors discard it, so it is rebuilt after new symbols
+     *  are added. Scanners of symbols shall not be changed afterwards.
+     *  Several threads may call it at once: one of them builds the lexer,
+     *  the others wait for it.
+     */
+    const Lexer<T>& lexer() const;
 };
 
 #endif
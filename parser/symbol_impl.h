@@ -2,13 +2,16 @@
 #define PARSER_SYMBOL_IMPL_H
 
 #include "symbol.h"
+#include "lexer.h"
 
 #include <limits>
 template <typename T>
-Symbol<T>::Symbol(std::string id, int lbp) : id(id), lbp(lbp) {}
+Symbol<T>::Symbol(std::string id, int lbp) : keywords(false), index_(0), id(id), lbp(lbp) {
+    first_chars.set();
+}
 
 template <typename T>
-size_t Symbol<T>::scan(const std::string& str, size_t pos) const {
+size_t Symbol<T>::scan(StringRef str, size_t pos) const {
     if (scanner) {
         return scanner(str, pos);
     } else {
@@ -23,7 +26,7 @@ size_t Symbol<T>::scan(const std::string& str, size_t pos) const {
 }
 
 template <typename T>
-T Symbol<T>::parse(const std::string& str, size_t beg, size_t end) const {
+T Symbol<T>::parse(StringRef str, size_t beg, size_t end) const {
     if (parser) {
         return parser(str, beg, end);
     } else {
@@ -37,9 +40,32 @@ bool Symbol<T>::has_scanner() const { return !!scanner; }
 template <typename T>
 bool Symbol<T>::has_parser() const { return !!parser; }
 
+template <typename T>
+bool Symbol<T>::may_start_with(unsigned char c) const { return first_chars[c]; }
+
+template <typename T>
+bool Symbol<T>::reserves_keywords() const { return keywords; }
+
+template <typename T>
+size_t Symbol<T>::index() const { return index_; }
+
+template <typename T>
+Symbol<T>& Symbol<T>::reserve_keywords() {
+    keywords = true; return *this;
+}
+
 template <typename T> 
 Symbol<T>& Symbol<T>::set_scanner(const ScannerType& s) {
-    scanner = s; return *this;
+    scanner = s; first_chars.set(); return *this;
+}
+
+template <typename T> 
+Symbol<T>& Symbol<T>::set_scanner(const ScannerType& s, const std::string& chars) {
+    scanner = s;
+    first_chars.reset();
+    for (size_t i = 0; i < chars.length(); ++i)
+        first_chars.set(static_cast<unsigned char>(chars[i]));
+    return *this;
 }
 
 template <typename T>
@@ -50,18 +76,35 @@ Symbol<T>& Symbol<T>::set_parser(const ParserType& p) {
 /* SymbolDict functions */
 
 template <typename T>
-SymbolDict<T>::SymbolDict(std::string end_id) : end_id(end_id) {
+SymbolDict<T>::SymbolDict(std::string end_id) : 
+    end_id(end_id), case_sensitive(true), published(nullptr) {
     Symbol<T> s(end_id, std::numeric_limits<int>::min());
     dict[end_id] = s;
 }
 
+template <typename T>
+SymbolDict<T>::SymbolDict(const SymbolDict<T>& other) : 
+    end_id(other.end_id), dict(other.dict), case_sensitive(other.case_sensitive), 
+    published(nullptr) {}
+
+template <typename T>
+SymbolDict<T>& SymbolDict<T>::operator=(const SymbolDict<T>& other) {
+    end_id = other.end_id;
+    dict = other.dict;
+    case_sensitive = other.case_sensitive;
+    discard_lexer();
+    return *this;
+}
+
 template <typename T>
 typename SymbolDict<T>::iterator SymbolDict<T>::begin() { 
+    discard_lexer();
     return dict.begin(); 
 }
 
 template <typename T>
 typename SymbolDict<T>::iterator SymbolDict<T>::end() {
+    discard_lexer();
     return dict.end();
 }
 
@@ -77,12 +120,19 @@ typename SymbolDict<T>::const_iterator SymbolDict<T>::cend() const {
 
 template <typename T>
 typename SymbolDict<T>::iterator SymbolDict<T>::find(const std::string& id) { 
+    discard_lexer();
     return dict.find(id); 
 }
 
 template <typename T>
 Symbol<T>& SymbolDict<T>::operator[](const std::string& id) {
-    return dict[id]; 
+    discard_lexer();
+    typename MapType::iterator it = dict.find(id);
+    if (it == dict.end()) {
+        it = dict.insert(std::make_pair(id, Symbol<T>())).first;
+        it -> second.index_ = dict.size() - 1; // symbols are never removed
+    }
+    return it -> second; 
 }
 
 template <typename T>
@@ -95,4 +145,34 @@ const std::string& SymbolDict<T>::get_end_id() {
     return end_id; 
 }
 
+template <typename T>
+void SymbolDict<T>::set_case_sensitive(bool sensitive) {
+    discard_lexer();
+    case_sensitive = sensitive;
+}
+
+template <typename T>
+bool SymbolDict<T>::is_case_sensitive() const {
+    return case_sensitive;
+}
+
+template <typename T>
+void SymbolDict<T>::discard_lexer() {
+    published.store(nullptr, std::memory_order_relaxed);
+    compiled.reset();
+}
+
+template <typename T>
+const Lexer<T>& SymbolDict<T>::lexer() const {
+    const Lexer<T>* lexer = published.load(std::memory_order_acquire);
+    if (lexer == nullptr) {
+        std::lock_guard<std::mutex> lock(compiling);
+        if (!compiled)
+            compiled.reset(new Lexer<T>(*this));
+        lexer = compiled.get();
+        published.store(lexer, std::memory_order_release);
+    }
+    return *lexer;
+}
+
 #endif
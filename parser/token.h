@@ -2,11 +2,11 @@
 #define PARSER_TOKEN_H
 
 #include "forward.h"
+#include "string_ref.h"
 
 #include <string>
 #include <functional>
 #include <locale>
-#include <memory>
 
 namespace token {
     /** Specializations of this class can be provided in order to treat
@@ -14,18 +14,12 @@ namespace token {
      */
     template <typename T>
     struct SkipWhiteSpace {
-        void operator()(const std::string& str, size_t& start, 
-                                                size_t& last_new_line,
-                                                size_t& current_line_) 
-        {
+        SkipWhiteSpace(StringRef) {}
+
+        void operator()(StringRef str, size_t& start) {
             static std::locale loc;
-            while (start < str.length() && std::isspace(str[start], loc)) {
-                if (str[start] == '\n') {
-                    last_new_line = start;
-                    ++current_line_;
-                }
+            while (start < str.length() && std::isspace(str[start], loc))
                 ++start;
-            }
         }
     };
 }
@@ -36,76 +30,100 @@ namespace token {
  * of the corresponding symbol.
  *
  * All accessor functions correspond to variables/member functions of
- * the symbol.
+ * the symbol; #nud and #led are those of the symbol in the current mode
+ * of the parser (see Mode), #lbp is that of the symbol itself.
+ *
+ * Tokens are small values. A token produced by a symbol having a parser
+ * (i.e. a literal token) carries the parsed value inline; nud of such
+ * a token just returns it.
  */
 template <typename T>
 class Token {
         const Symbol<T>* sym_ptr; ///< Pointer to the corresponding symbol
+        T value; ///< Value of a literal token, default-constructed otherwise
     public:
         size_t start_position; ///< Position of the beginning of the token in the string being parsed.
         size_t length; ///< Length of token string representation.
 
         Token(const Symbol<T>& sym, size_t start=0, size_t end=0);
-        virtual ~Token();
+        /// Constructs a literal token
+        Token(const Symbol<T>& sym, T value, size_t start, size_t end);
 
         const std::string& id() const;
         const Symbol<T>& symbol() const;
         int lbp() const;
-        virtual T nud(PrattParser<T>& parser) const;
+        bool is_literal() const;
+        /** Returns the value of a literal token. For other tokens 
+         *  calls nud of the symbol which usually parses some subsequent 
+         *  part of string.
+         */
+        T nud(PrattParser<T>& parser) const;
         T led(PrattParser<T>& parser, T left) const;
 
-        /// Delivers instances of Token/LiteralToken to PrattParser instance.
-        /** Instances are delivered via \a unique_ptr so as to use polymorhic
-         *  behaviour of Token with respect to Token.nud
-         */
+        /// Delivers tokens to PrattParser instance.
         class iterator {
-            const std::string& str; ///< references the string being parsed
+            StringRef str; ///< the string being parsed or the window of #reader
+            ChunkedReader* reader; ///< nullptr unless the string is read piece by piece
+            size_t base;  ///< position of #str in the whole string
             const SymbolDict<T>& symbols; ///< references symbols of the Grammar used
+            const Lexer<T>& lexer; ///< compiled form of #symbols
             size_t start; ///< position in #str of the beginning of current Token
             size_t end;   ///< position in #str after the end of current Token
+            size_t kept;  ///< position in #str of the token returned last
             const Symbol<T>* match; ///< points to Symbol which matches current Token
-            size_t last_new_line_;  ///< position in #str of last '\n' character
-            size_t current_line_;   ///< one-indexed current line
+
+            /** token::SkipWhiteSpace shall be constructible from the string
+             *  being parsed (so it may prepare whatever it needs for that
+             *  string) and have
+             *      void operator()(StringRef, size_t& start);
+             *      which shall move \a start to the beginning of the next token.
+             *  It is called with \a start being the end of the previous token.
+             *  Lines are not tracked while lexing, see LineIndex.
+             *
+             *  With a ChunkedReader it is constructed from the first window
+             *  and then called on every window in turn, so only a
+             *  SkipWhiteSpace which doesn't prepare anything can be used.
+             */
+            token::SkipWhiteSpace<T> skip_white_space;
+
+            /// Moves the window of #reader so that it begins at #kept
+            void refill();
             public:
             /// initializes #str and #symbols
-            iterator(const std::string& str,
+            iterator(StringRef str,
                      const SymbolDict<T>& symbols);
 
-            /** token::SkipWhiteSpace shall have
-             *      void operator()(const std::string&, size_t& start, 
-             *                                          size_t& last_new_line,
-             *                                          size_t& new_lines);
-             *      which shall update the number of new lines encountered,
-             *                  update \a start position and \a last_new_line appropriately.
+            /** Reads the string from \a reader, which shall outlive the iterator.
+             *  The window is moved forward when less than a half 
+             *  of it is left to lex; it keeps the token returned last 
+             *  and the next one, so together with white space between
+             *  them they shall fit into it (otherwise std::length_error is thrown).
+             *  Symbol::parse is given the window, which the value of a literal
+             *  token shall not refer to.
              */
-            static typename token::SkipWhiteSpace<T> skip_white_space;
+            iterator(ChunkedReader& reader,
+                     const SymbolDict<T>& symbols);
 
-            /** Skips whitespace and tries to scan #str for all symbols of Grammar in turn 
-             *  starting from #end. If the end of #str is reached returns symbols.end_symbol()
+            /** Skips whitespace and matches #str against symbols of Grammar
+             *  starting from #end (see Lexer). If the end of #str is reached 
+             *  returns symbols.end_symbol()
              *
              *  Uses longest-match highest-precedence rule.
              */
             iterator& operator++();
-            /// Returns pointer to Token/LiteralToken instance.
-            std::unique_ptr<Token<T>> operator*();
-
-            /// Zero-indexed position of last '\n' encountered in #str
-            size_t last_new_line() const;
+            /// Returns current token, parsing its value if it is literal.
+            Token<T> operator*();
 
-            /// One-indexed current line
-            size_t current_line() const; 
-        };
-};
+            /// The string being parsed, or the part of it which is in memory
+            StringRef code() const;
 
-/// Represents terminal token.
-template <typename T>
-struct LiteralToken : public Token<T> {
-    T value;
-    LiteralToken(const Symbol<T>& sym, T value, size_t start=0, size_t end=0);
+            /** Text at \a position of the whole string; the token returned
+             *  last and the current one are always available.
+             */
+            StringRef text(size_t position, size_t length) const;
 
-    /** Just returns #value whereas non-literal tokens usually need to 
-     * parse some subsequent part of string.
-     */
-    virtual T nud(PrattParser<T>&) const;
+            /// Lines indexed by the reader or nullptr if there is no reader
+            const LineIndex* lines() const;
+        };
 };
 #endif
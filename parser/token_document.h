@@ -0,0 +1,152 @@
+#ifndef PARSER_TOKEN_DOCUMENT_H
+#define PARSER_TOKEN_DOCUMENT_H
+
+#include "forward.h"
+#include "token.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Tokens [first, first + removed) were replaced with [first, first + inserted)
+struct TokenChange {
+    size_t first;
+    size_t removed;
+    size_t inserted;
+};
+
+/// Tokens of a text which is being edited.
+/** Tokens are stored column-wise like in TokenStream, and like it
+ *  the document doesn't own the text: whoever edits the text tells
+ *  the document of every edit. After an edit only the tokens
+ *  around it are lexed again: lexing restarts at the end of a token
+ *  lying before the edit, which is never inside a comment or a string,
+ *  and stops as soon as a new token coincides with an old one shifted
+ *  by the edit, since everything after it is lexed from the same text.
+ *  A comment opened or closed by an edit thus makes the document
+ *  relex up to the point where the old and new tokens line up again.
+ *
+ *  White space is skipped by token::SkipWhiteSpace, constructed on
+ *  a window of the text beginning at the restart point, and then on
+ *  twice as long windows from the end of the last token when it is
+ *  used up. Symbols are matched against the whole text. A character no
+ *  symbol matches starts a new window after it; so e.g. an apostrophe 
+ *  which is never closed doesn't make the rest of the text a string.
+ *
+ *  The arrays of tokens have a gap at the last edit, so that tokens
+ *  are inserted and removed there without moving the others. Starts
+ *  of tokens after the gap are stored without the shift made by edits
+ *  since the gap got there; when the gap moves to the next edit, the
+ *  tokens between the two are moved and shifted. Edits close to each
+ *  other thus cost about the same however long the text is.
+ *
+ *  Unlike TokenStream, there is no end token, and a character no
+ *  symbol matches becomes an invalid token of length one (see #is_valid).
+ *  A scanner may have failed on it looking up to the end of the text,
+ *  as on an apostrophe which isn't closed yet, so an edit makes
+ *  the document relex from the first invalid token before the edit;
+ *  such tokens are rare, and typically just before the edit.
+ *  Values of literal tokens aren't kept, as they may refer to the text;
+ *  #value produces them when asked to.
+ *
+ *  Texts longer than 4GB are not supported.
+ */
+template <typename T>
+class TokenDocument {
+        StringRef text_; ///< the text after the last edit
+
+        const Lexer<T>* lexer;
+
+        /// Symbols of the grammar; #symbols stores indices into this table
+        std::vector<const Symbol<T>*> table;
+
+        std::vector<uint32_t> symbols; ///< index in #table of each token or NO_SYMBOL
+        std::vector<uint32_t> starts;  ///< position of each token, without #shift after the gap
+        std::vector<uint32_t> lengths; ///< length of each token
+
+        std::vector<size_t> invalid_; ///< see #invalid
+
+        size_t gap;      ///< index of the token after the gap
+        size_t gap_size; ///< number of unused elements of the arrays
+        uint32_t shift;  ///< to be added to starts after the gap, modulo 2^32
+
+        bool case_sensitive_;
+
+        struct Lexed {
+            uint32_t symbol;
+            uint32_t start;
+            uint32_t length;
+        };
+
+        /// Index in the arrays of \a i-th token
+        size_t at(size_t i) const;
+
+        /// Moves the gap before \a i-th token
+        void move_gap(size_t i);
+
+        /** Lexes the text from \a from, which shall be the end of a token
+         *  or 0, passing tokens to \a take until it returns false
+         *  or the text ends.
+         */
+        template <typename F>
+        void lex(size_t from, F take) const;
+
+    public:
+        static const uint32_t NO_SYMBOL = 0xFFFFFFFFu;
+
+        /** Scanners are assumed not to look further than this
+         *  many characters past the end of the tokens they produce,
+         *  so tokens ending closer to an edit are lexed again, and
+         *  white space found this close to the end of a window is
+         *  looked for again in the next one.
+         */
+        static const size_t LOOKAHEAD = 16;
+
+        /// Length of the first window white space is skipped in
+        static const size_t WINDOW = 256;
+
+        /// Lexes \a text with symbols of \a dict, which shall outlive the document.
+        TokenDocument(StringRef text, const SymbolDict<T>& dict);
+
+        /** Updates the tokens after \a removed characters at \a offset 
+         *  were replaced with \a inserted ones, \a text being the whole
+         *  text after that. Returns which tokens changed; tokens after 
+         *  the change keep their symbols and lengths. Throws 
+         *  std::out_of_range if the edit doesn't fit the texts.
+         */
+        TokenChange edit(StringRef text, size_t offset, size_t removed, size_t inserted);
+
+        /// The text after the last edit
+        StringRef text() const;
+
+        /// Number of tokens in the document
+        size_t size() const;
+
+        /// false if no symbol matches the character of \a i-th token
+        bool is_valid(size_t i) const;
+
+        /// Indices of invalid tokens in ascending order
+        const std::vector<size_t>& invalid() const;
+
+        /// Symbol of a valid token
+        const Symbol<T>& symbol(size_t i) const;
+
+        /// All symbols of the dictionary the text is lexed with
+        const std::vector<const Symbol<T>*>& symbol_table() const;
+
+        size_t start(size_t i) const;
+        size_t length(size_t i) const;
+
+        StringRef token_text(size_t i) const;
+
+        /// true if \a i-th token is valid and its symbol has a parser
+        bool is_literal(size_t i) const;
+
+        /// Parses the value of \a i-th token, which shall be literal
+        T value(size_t i) const;
+
+        /// See SymbolDict::set_case_sensitive
+        bool case_sensitive() const;
+};
+
+#endif
@@ -0,0 +1,229 @@
+#ifndef PARSER_TOKEN_DOCUMENT_IMPL_H
+#define PARSER_TOKEN_DOCUMENT_IMPL_H
+
+#include "token_document.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+template <typename T> const uint32_t TokenDocument<T>::NO_SYMBOL;
+template <typename T> const size_t TokenDocument<T>::LOOKAHEAD;
+template <typename T> const size_t TokenDocument<T>::WINDOW;
+
+template <typename T>
+TokenDocument<T>::TokenDocument(StringRef text, const SymbolDict<T>& dict) :
+    text_(text), lexer(&dict.lexer()), table(dict.lexer().symbol_table()),
+    gap(0), gap_size(0), shift(0), case_sensitive_(dict.is_case_sensitive())
+{
+    if (text_.length() >= std::numeric_limits<uint32_t>::max())
+        throw std::length_error("text is too long for TokenDocument");
+
+    lex(0, [this](const Lexed& token) {
+        if (token.symbol == NO_SYMBOL)
+            invalid_.push_back(size());
+        symbols.push_back(token.symbol);
+        starts.push_back(token.start);
+        lengths.push_back(token.length);
+        return true;
+    });
+    gap = size();
+}
+
+template <typename T>
+template <typename F>
+void TokenDocument<T>::lex(size_t from, F take) const {
+    StringRef text = text_;
+    size_t base = from, span = WINDOW;
+    for ( ; ; ) {
+        StringRef window = text.substr(base, std::min(span, text.length() - base));
+        bool last = base + window.length() == text.length();
+        token::SkipWhiteSpace<T> white_space(window);
+
+        size_t pos = 0; // in the window, after the last token
+        bool invalid = false;
+        while (!invalid && pos < window.length()) {
+            size_t start = pos, end;
+            white_space(window, start);
+            if (start == window.length() || (!last && start + LOOKAHEAD >= window.length()))
+                break; // a comment may go on past the window, or begin at its end
+            uint32_t index = lexer -> match_index(text, base + start, end);
+            invalid = index == NO_SYMBOL;
+            if (invalid)
+                end = base + start + 1;
+            if (!take(Lexed{index, uint32_t(base + start), uint32_t(end - base - start)}))
+                return;
+            pos = end - base;
+        }
+        if (last && !invalid)
+            return;
+        // the text after a character no symbol matches is indexed 
+        // anew, as if it began there
+        span = invalid ? WINDOW : span * 2;
+        base += pos;
+    }
+}
+
+template <typename T>
+size_t TokenDocument<T>::at(size_t i) const {
+    return i < gap ? i : i + gap_size;
+}
+
+template <typename T>
+void TokenDocument<T>::move_gap(size_t i) {
+    if (i > gap) { // tokens after the gap move before it
+        size_t from = gap + gap_size, count = i - gap;
+        std::copy(symbols.begin() + from, symbols.begin() + from + count, symbols.begin() + gap);
+        std::copy(lengths.begin() + from, lengths.begin() + from + count, lengths.begin() + gap);
+        for (size_t k = 0; k < count; ++k)
+            starts[gap + k] = starts[from + k] + shift;
+    } else if (i < gap) {
+        size_t to = i + gap_size, count = gap - i;
+        std::copy_backward(symbols.begin() + i, symbols.begin() + gap, symbols.begin() + to + count);
+        std::copy_backward(lengths.begin() + i, lengths.begin() + gap, lengths.begin() + to + count);
+        for (size_t k = count; k > 0; --k)
+            starts[to + k - 1] = starts[i + k - 1] - shift;
+    }
+    gap = i;
+}
+
+template <typename T>
+TokenChange TokenDocument<T>::edit(StringRef text, size_t offset, size_t removed, size_t inserted) {
+    if (offset > text_.length() || removed > text_.length() - offset ||
+            text.length() != text_.length() - removed + inserted)
+        throw std::out_of_range("edit doesn't fit the text");
+    if (text.length() >= std::numeric_limits<uint32_t>::max())
+        throw std::length_error("text is too long for TokenDocument");
+
+    // tokens ending far enough before the edit stay as they are
+    size_t first = 0, count = size();
+    while (count > 0) {
+        size_t half = count / 2;
+        if (start(first + half) + length(first + half) + LOOKAHEAD < offset) {
+            first += half + 1;
+            count -= half + 1;
+        } else {
+            count = half;
+        }
+    }
+    if (!invalid_.empty() && invalid_.front() < first)
+        first = invalid_.front();
+    size_t restart = first == 0 ? 0 : start(first - 1) + length(first - 1);
+
+    text_ = text;
+    size_t edited_end = offset + inserted; // in the new text
+    uint32_t delta = uint32_t(inserted) - uint32_t(removed);
+
+    std::vector<Lexed> lexed;
+    size_t old = first; // the first old token which may line up
+    bool lined_up = false;
+    lex(restart, [&](const Lexed& token) {
+        if (token.start >= edited_end) {
+            uint32_t was = token.start - delta; // where it would have been
+            while (old < size() && start(old) < was)
+                ++old;
+            if (old < size() && start(old) == was &&
+                    symbols[at(old)] == token.symbol && lengths[at(old)] == token.length) {
+                lined_up = true; // the rest is lexed from the same text
+                return false;
+            }
+        }
+        lexed.push_back(token);
+        return true;
+    });
+    if (!lined_up)
+        old = size(); // all tokens up to the end of the text changed
+
+    move_gap(old);
+    size_t kept = old - first;
+    gap = first; // the old tokens are dropped into the gap
+    gap_size += kept;
+    if (gap_size < lexed.size()) {
+        size_t after = symbols.size() - gap - gap_size;
+        size_t grown = std::max(2 * symbols.size(), symbols.size() + lexed.size());
+        symbols.resize(grown);
+        starts.resize(grown);
+        lengths.resize(grown);
+        std::copy_backward(symbols.begin() + gap + gap_size, 
+                           symbols.begin() + gap + gap_size + after, symbols.end());
+        std::copy_backward(starts.begin() + gap + gap_size, 
+                           starts.begin() + gap + gap_size + after, starts.end());
+        std::copy_backward(lengths.begin() + gap + gap_size, 
+                           lengths.begin() + gap + gap_size + after, lengths.end());
+        gap_size = grown - gap - after;
+    }
+    for (size_t i = 0; i < lexed.size(); ++i) {
+        symbols[gap + i] = lexed[i].symbol;
+        starts[gap + i] = lexed[i].start;
+        lengths[gap + i] = lexed[i].length;
+    }
+
+    // indices of invalid tokens from the changed ones on
+    std::vector<size_t>::iterator changed = 
+        std::lower_bound(invalid_.begin(), invalid_.end(), first);
+    std::vector<size_t> after;
+    for (size_t i = 0; i < lexed.size(); ++i)
+        if (lexed[i].symbol == NO_SYMBOL)
+            after.push_back(first + i);
+    for (std::vector<size_t>::iterator i = changed; i != invalid_.end(); ++i)
+        if (*i >= old)
+            after.push_back(*i - kept + lexed.size());
+    invalid_.erase(changed, invalid_.end());
+    invalid_.insert(invalid_.end(), after.begin(), after.end());
+
+    gap += lexed.size();
+    gap_size -= lexed.size();
+    shift += delta;
+    return TokenChange{first, kept, lexed.size()};
+}
+
+template <typename T>
+StringRef TokenDocument<T>::text() const { return text_; }
+
+template <typename T>
+size_t TokenDocument<T>::size() const { return symbols.size() - gap_size; }
+
+template <typename T>
+bool TokenDocument<T>::is_valid(size_t i) const { return symbols[at(i)] != NO_SYMBOL; }
+
+template <typename T>
+const std::vector<size_t>& TokenDocument<T>::invalid() const { return invalid_; }
+
+template <typename T>
+const Symbol<T>& TokenDocument<T>::symbol(size_t i) const {
+    return *table[symbols[at(i)]];
+}
+
+template <typename T>
+const std::vector<const Symbol<T>*>& TokenDocument<T>::symbol_table() const {
+    return table;
+}
+
+template <typename T>
+size_t TokenDocument<T>::start(size_t i) const {
+    return i < gap ? starts[i] : uint32_t(starts[i + gap_size] + shift);
+}
+
+template <typename T>
+size_t TokenDocument<T>::length(size_t i) const { return lengths[at(i)]; }
+
+template <typename T>
+StringRef TokenDocument<T>::token_text(size_t i) const {
+    return text_.substr(start(i), length(i));
+}
+
+template <typename T>
+bool TokenDocument<T>::is_literal(size_t i) const {
+    return is_valid(i) && table[symbols[at(i)]] -> has_parser();
+}
+
+template <typename T>
+T TokenDocument<T>::value(size_t i) const {
+    size_t begin = start(i);
+    return table[symbols[at(i)]] -> parse(text_, begin, begin + length(i));
+}
+
+template <typename T>
+bool TokenDocument<T>::case_sensitive() const { return case_sensitive_; }
+
+#endif
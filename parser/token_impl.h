@@ -2,16 +2,19 @@
 #define PARSER_TOKEN_IMPL_H
 
 #include "token.h"
+#include "source.h"
+#include "parse_error.h"
 
 #include <locale>
 #include <stdexcept>
-#include <sstream>
 
 template <typename T>
 Token<T>::Token(const Symbol<T>& sym, size_t start, size_t end) :
-            sym_ptr(&sym), start_position(start), length(end - start) {}
+            sym_ptr(&sym), value(), start_position(start), length(end - start) {}
 
-template <typename T> Token<T>::~Token() {}
+template <typename T>
+Token<T>::Token(const Symbol<T>& sym, T val, size_t start, size_t end) :
+            sym_ptr(&sym), value(val), start_position(start), length(end - start) {}
 
 template <typename T>
 const std::string& Token<T>::id() const { return sym_ptr -> id; }
@@ -22,93 +25,117 @@ const Symbol<T>& Token<T>::symbol() const { return *sym_ptr; }
 template <typename T>
 int Token<T>::lbp() const { return sym_ptr -> lbp; }
 
+template <typename T>
+bool Token<T>::is_literal() const { return sym_ptr -> has_parser(); }
+
 template <typename T>
 T Token<T>::nud(PrattParser<T>& parser) const {
-    if (!sym_ptr -> nud) {
-        std::stringstream ss;
-        ss << "parsing error near line " << parser.current_position().line 
-           << ": expected prefix operator";
-        throw std::runtime_error(ss.str());
-    }
-    return sym_ptr -> nud(parser);
+    if (is_literal())
+        return value;
+    const std::function<T(PrattParser<T>&)>& nud = parser.nud_of(*sym_ptr);
+    if (!nud)
+        throw ParseError("expected prefix operator", start_position,
+                         parser.position_of(start_position).line);
+    return nud(parser);
 }
 
 template <typename T>
 T Token<T>::led(PrattParser<T>& parser, T left) const {
-    if (!sym_ptr -> led) {
-        std::stringstream ss;
-        ss << "parsing error near line " << parser.current_position().line 
-           << ": unexpected infix/postfix operator";
-        throw std::runtime_error(ss.str());
-    }
-    return sym_ptr -> led(parser, left);
+    const std::function<T(PrattParser<T>&, T)>& led = parser.led_of(*sym_ptr);
+    if (!led)
+        throw ParseError("unexpected infix/postfix operator", start_position,
+                         parser.position_of(start_position).line);
+    return led(parser, left);
 }
 
 template <typename T>
-Token<T>::iterator::iterator(const std::string& s, 
+Token<T>::iterator::iterator(StringRef s, 
          const SymbolDict<T>& symbols) :
-    str(s), symbols(symbols), start(0), end(0),
-    last_new_line_(0), current_line_(1) {
+    str(s), reader(nullptr), base(0), 
+    symbols(symbols), lexer(symbols.lexer()), start(0), end(0), kept(0),
+    skip_white_space(s) {
         operator++();
 }
 
 template <typename T>
-typename token::SkipWhiteSpace<T> Token<T>::iterator::skip_white_space;
+Token<T>::iterator::iterator(ChunkedReader& r, 
+         const SymbolDict<T>& symbols) :
+    str(r.window()), reader(&r), base(r.offset()), 
+    symbols(symbols), lexer(symbols.lexer()), start(0), end(0), kept(0),
+    skip_white_space(str) {
+        operator++();
+}
+
+template <typename T>
+void Token<T>::iterator::refill() {
+    reader -> refill(base + kept);
+    size_t shift = reader -> offset() - base;
+    start -= shift;
+    end -= shift;
+    kept = 0;
+    base = reader -> offset();
+    str = reader -> window();
+}
 
 template <typename T>
 typename Token<T>::iterator& Token<T>::iterator::operator++() {
 
-    skip_white_space(str, start, last_new_line_, current_line_);
+    if (reader) {
+        /* white space may span several windows */
+        for ( ; ; ) {
+            skip_white_space(str, start);
+            if (reader -> at_end() || str.length() - start >= reader -> capacity() / 2)
+                break;
+            if (kept == 0 && str.length() == reader -> capacity()) { // can't be moved
+                if (start == str.length())
+                    throw std::length_error("white space doesn't fit into the window");
+                break;
+            }
+            refill();
+        }
+    } else {
+        skip_white_space(str, start);
+    }
 
     if (start < str.length()) {
-        end = start;
-        match = nullptr;
-        for (auto it = symbols.cbegin(); it != symbols.cend(); ++it) {
-            const Symbol<T>& sym = it -> second;
-            size_t p = sym.scan(str, start);
-            /* longest match with highest precedence */
-            if (p > end || 
-                    (match != nullptr && 
-                     sym.lbp > match -> lbp &&
-                     p == end)) {
-                match = &sym;
-                end = p;
-            } 
-        }
-        if (end == start) {
+        match = lexer.match(str, start, end);
+        if (match == nullptr) {
             throw std::runtime_error("invalid symbol");
         }
+        if (reader && end == str.length() && !reader -> at_end())
+            throw std::length_error("token doesn't fit into the window");
     }
     return *this;
 }
 
 template <typename T>
-std::unique_ptr<Token<T>> Token<T>::iterator::operator*() {
+Token<T> Token<T>::iterator::operator*() {
     if (start >= str.length()) {
-        return std::unique_ptr<Token<T>>(new Token<T>(symbols.end_symbol()));
+        kept = start;
+        return Token<T>(symbols.end_symbol(), base + start, base + start);
     }
     size_t old_start = start;
+    kept = start;
     start = end;
     if (match -> has_parser()) {
-        return std::unique_ptr<Token<T>>(
-                     new LiteralToken<T>(*match, match -> parse(str, old_start, end),
-                                         old_start, end));
+        return Token<T>(*match, match -> parse(str, old_start, end), 
+                        base + old_start, base + end);
     } else {
-        return std::unique_ptr<Token<T>>(new Token<T>(*match, old_start, end));
+        return Token<T>(*match, base + old_start, base + end);
     }
 }
 
 template <typename T>
-size_t Token<T>::iterator::last_new_line() const { return last_new_line_; }
+StringRef Token<T>::iterator::code() const { return str; }
 
 template <typename T>
-size_t Token<T>::iterator::current_line() const { return current_line_; }
-
-template <typename T>
-LiteralToken<T>::LiteralToken(const Symbol<T>& sym, T val, size_t start, size_t end) :
-    Token<T>(sym, start, end), value(val) {}
+StringRef Token<T>::iterator::text(size_t position, size_t length) const {
+    return str.substr(position - base, length);
+}
 
 template <typename T>
-T LiteralToken<T>::nud(PrattParser<T>&) const { return value; }
+const LineIndex* Token<T>::iterator::lines() const {
+    return reader ? &reader -> lines() : nullptr;
+}
 
 #endif
@@ -0,0 +1,91 @@
+#ifndef PARSER_TOKEN_STREAM_H
+#define PARSER_TOKEN_STREAM_H
+
+#include "forward.h"
+#include "token.h"
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+/// Tokens of a whole string, lexed in advance.
+/** Unlike Token::iterator, which produces tokens one by one on the heap,
+ *  the whole string is lexed at construction and the tokens are stored 
+ *  column-wise in a few flat arrays. Values of literal tokens are 
+ *  stored in a separate array and referred to by index. 
+ *  Lines are not stored, see LineIndex.
+ *
+ *  The last token is always the end symbol of the dictionary, unless 
+ *  lexing stopped at an invalid symbol (see #complete).
+ *
+ *  PrattParser can walk a TokenStream with a cursor instead of lexing 
+ *  on the fly. The stream may also be used on its own, e.g. to measure
+ *  the throughput of the lexer separately from that of the parser.
+ *
+ *  Notice: lexing decisions are made before parsing begins, so changes 
+ *  of Symbol#lbp made by parsing routines don't affect how ties between 
+ *  symbols are broken (see Lexer).
+ */
+template <typename T>
+class TokenStream {
+        StringRef str; ///< the string being parsed
+
+        token::SkipWhiteSpace<T> white_space_; ///< see Token::iterator
+
+        /// Symbols of the grammar; #symbols stores indices into this table
+        std::vector<const Symbol<T>*> table;
+
+        std::vector<uint32_t> symbols;  ///< index in #table of each token
+        std::vector<uint32_t> starts;   ///< position in #str of each token
+        std::vector<uint32_t> lengths;  ///< length of each token
+        std::vector<uint32_t> literals; ///< index in #values or NO_LITERAL
+        std::vector<T> values;          ///< values of literal tokens
+
+        std::vector<uint32_t> invalid_; ///< see #invalid
+
+        bool complete_;
+        bool case_sensitive_;
+
+    public:
+        static const uint32_t NO_LITERAL = 0xFFFFFFFFu;
+
+        /** Lexes \a str with symbols of \a dict. 
+         *  Strings longer than 4GB are not supported.
+         *  If \a skip_invalid is set, a character no symbol matches
+         *  is skipped instead of ending the stream.
+         */
+        TokenStream(StringRef str, const SymbolDict<T>& dict, bool skip_invalid = false);
+
+        /// Number of tokens in the stream
+        size_t size() const;
+
+        /// false if lexing stopped at an invalid symbol after the last token
+        bool complete() const;
+
+        /// Positions of the characters skipped because no symbol matched them
+        const std::vector<uint32_t>& invalid() const;
+
+        const Symbol<T>& symbol(size_t i) const;
+
+        /// All symbols of the dictionary the string was lexed with
+        const std::vector<const Symbol<T>*>& symbol_table() const;
+        size_t start(size_t i) const;
+        size_t length(size_t i) const;
+
+        /// true if \a i-th token was produced by a symbol with a parser
+        bool is_literal(size_t i) const;
+
+        /// Value of \a i-th token if it is literal
+        const T& value(size_t i) const;
+
+        /// Returns the string which was lexed
+        StringRef code() const;
+
+        /// See SymbolDict::set_case_sensitive
+        bool case_sensitive() const;
+
+        /// Gives access to what the specialization of token::SkipWhiteSpace knows of the string
+        const token::SkipWhiteSpace<T>& white_space() const;
+};
+
+#endif
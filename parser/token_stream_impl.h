@@ -0,0 +1,99 @@
+#ifndef PARSER_TOKEN_STREAM_IMPL_H
+#define PARSER_TOKEN_STREAM_IMPL_H
+
+#include "token_stream.h"
+
+#include <limits>
+#include <stdexcept>
+
+template <typename T> const uint32_t TokenStream<T>::NO_LITERAL;
+
+template <typename T>
+TokenStream<T>::TokenStream(StringRef s, const SymbolDict<T>& dict, bool skip_invalid) :
+    str(s), white_space_(s), complete_(false), case_sensitive_(dict.is_case_sensitive())
+{
+    if (str.length() >= std::numeric_limits<uint32_t>::max())
+        throw std::length_error("string is too long for TokenStream");
+
+    const Lexer<T>& lexer = dict.lexer();
+    table = lexer.symbol_table();
+
+    uint32_t end_symbol = 0;
+    while (table[end_symbol] != &dict.end_symbol())
+        ++end_symbol;
+
+    size_t start = 0, end = 0;
+    for ( ; ; ) {
+        white_space_(str, start);
+        uint32_t index = end_symbol;
+        if (start < str.length()) {
+            index = lexer.match_index(str, start, end);
+            if (index == Lexer<T>::NO_SYMBOL) {
+                if (!skip_invalid)
+                    return; // incomplete
+                invalid_.push_back(start++);
+                continue;
+            }
+        } else {
+            start = end = str.length();
+        }
+
+        const Symbol<T>& sym = *table[index];
+        symbols.push_back(index);
+        starts.push_back(start);
+        lengths.push_back(end - start);
+        if (sym.has_parser()) {
+            literals.push_back(values.size());
+            values.push_back(sym.parse(str, start, end));
+        } else {
+            literals.push_back(NO_LITERAL);
+        }
+
+        if (index == end_symbol)
+            break;
+        start = end;
+    }
+    complete_ = true;
+}
+
+template <typename T>
+size_t TokenStream<T>::size() const { return symbols.size(); }
+
+template <typename T>
+bool TokenStream<T>::complete() const { return complete_; }
+
+template <typename T>
+const std::vector<uint32_t>& TokenStream<T>::invalid() const { return invalid_; }
+
+template <typename T>
+const Symbol<T>& TokenStream<T>::symbol(size_t i) const { 
+    return *table[symbols[i]]; 
+}
+
+template <typename T>
+const std::vector<const Symbol<T>*>& TokenStream<T>::symbol_table() const {
+    return table;
+}
+
+template <typename T>
+size_t TokenStream<T>::start(size_t i) const { return starts[i]; }
+
+template <typename T>
+size_t TokenStream<T>::length(size_t i) const { return lengths[i]; }
+
+template <typename T>
+bool TokenStream<T>::is_literal(size_t i) const { return literals[i] != NO_LITERAL; }
+
+template <typename T>
+const T& TokenStream<T>::value(size_t i) const { return values[literals[i]]; }
+
+template <typename T>
+StringRef TokenStream<T>::code() const { return str; }
+
+template <typename T>
+bool TokenStream<T>::case_sensitive() const { return case_sensitive_; }
+
+template <typename T>
+const token::SkipWhiteSpace<T>& TokenStream<T>::white_space() const { return white_space_; }
+
+#endif
@@ -2,7 +2,6 @@
 #define AST_VISITORS_H
 
 //#include <memory>
-//#include <forward_list>
 #include <cassert>
 #include <sstream>
 //#include <string>
@@ -52,76 +51,72 @@ struct ListVisitor : public AstThrowVisitor {
     using AstThrowVisitor::visit;
     /* for right-associative operators */
 
-    /// references are non-const because conversion might be performed
-    ListVisitor(std::shared_ptr<Node>& left,
-                std::shared_ptr<Node>& right,
+    /** Takes all operands of the operator at once; the last one may be
+     *  a list already, which is then continued. Operands are checked
+     *  from the last one, as if the operator made a list at each of them.
+     *  References are non-const because conversion might be performed.
+     */
+    ListVisitor(std::vector<std::shared_ptr<Node>>& operands,
                 const PascalGrammar* const pg,
-                std::string expected) : visited_right(false),
-                                        grammar(pg), expected(expected) {
+                std::string expected) : grammar(pg), expected(expected) {
 
         Visits<ListVisitor<_Type, try_to_convert, _ListType>, _Type, _ListType>();
 
-        if (!node_traits::has_type<_ListType>(right)) {
-            try_to_convert_to<_Type>(right, true);
-            right = node::make_list(std::static_pointer_cast<_Type>(right));
-            /* otherwise ListOf<Node> will be created */
+        std::shared_ptr<Node>& last = operands.back();
+        size_t count = operands.size();
+        if (node_traits::has_type<_ListType>(last)) {
+            count += std::static_pointer_cast<_ListType>(last) -> list().size() - 1;
+        } else if (!try_to_convert_to<_Type>(last, true)) {
+            return;
         }
-
-        try_to_convert_to<_Type>(left);
-
-        travel(right);
-        travel(left);
+        for (size_t i = operands.size() - 1; i-- > 0; )
+            if (!try_to_convert_to<_Type>(operands[i]))
+                return;
+
+        ids.reserve(count);
+        for (std::shared_ptr<Node>& operand : operands)
+            travel(operand);
+        expr = make_node<_ListType>(std::move(ids));
     }
 
-    /// supposed to visit left node
     void visit(const std::shared_ptr<_Type>& id) {
-        if (visited_right) {
-#ifdef DEBUG
-            std::cout << "visited node on the left" << std::endl;
-#endif
-            ids.push_front(id);
-            expr = std::make_shared<_ListType>(std::move(ids));
-        } else {
-            assert(0);
-        }
+        ids.push_back(id);
     }
 
-    /// supposed to visit right node
+    /// supposed to visit the last operand
     void visit(const std::shared_ptr<_ListType>& id_list) {
-        if (!visited_right) {
-            visited_right = true;
 #ifdef DEBUG
-            std::cout << "visited list on the right" << std::endl;
+        std::cout << "visited list on the right" << std::endl;
 #endif
-            ids = std::move(id_list -> list());
-        } else {
-            assert(0);
-        }
+        for (PNode& id : id_list -> list())
+            ids.push_back(std::move(id));
     }
 
     /// Returns the node generated during the visit
     std::shared_ptr<Node> get_expression() { return expr; }
 
 private:
-    bool visited_right;
     const PascalGrammar* const grammar;
     std::string expected;
 
-    std::forward_list<std::shared_ptr<Node>> ids;
+    NodeList ids;
     std::shared_ptr<Node> expr;
 
     static ConvertHelper<_Type, try_to_convert> convert_helper;
 
+    /// on failure, the expression is what the grammar's error() returned
     template <typename T>
-    void try_to_convert_to(std::shared_ptr<Node>& node, bool list=false) {
+    bool try_to_convert_to(std::shared_ptr<Node>& node, bool list=false) {
         if (!convert_helper(node)) {
             std::stringstream err;
             err << "expected " << expected;
             if (list) {
                 err << " list";
             }
-            grammar -> error(err.str());
+            expr = grammar -> error(err.str());
+            return false;
         }
+        return true;
     }
 };
 
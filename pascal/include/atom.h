@@ -0,0 +1,66 @@
+#ifndef ATOM_H
+#define ATOM_H
+
+#include <iosfwd>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+#include "string_ref.h"
+
+/// Interned string: atoms of equal strings have the same 32-bit id.
+/** Strings are interned in one table shared by all threads and kept
+ *  until #clear is called, so atoms made by different parses may be
+ *  compared. Ids are dense: 0 is the empty string, and the others are
+ *  given in the order of interning, so that an analysis pass may keep
+ *  its data about names in a vector of count() elements.
+ */
+class Atom {
+        uint32_t id_;
+
+        explicit Atom(uint32_t id) : id_(id) {}
+
+    public:
+        /// The empty string
+        Atom() : id_(0) {}
+
+        explicit Atom(StringRef str);
+
+        /// Interns \a str with A-Z folded to a-z
+        static Atom lower_case(StringRef str);
+
+        /// Atom with the given id, which must be that of an existing one
+        static Atom from_id(uint32_t id);
+
+        uint32_t id() const { return id_; }
+        /// Valid until #clear is called
+        StringRef str() const;
+
+        bool operator==(Atom other) const { return id_ == other.id_; }
+        bool operator!=(Atom other) const { return id_ != other.id_; }
+        /// Order of interning, not that of the strings
+        bool operator<(Atom other) const { return id_ < other.id_; }
+
+        /// Number of atoms interned so far
+        static size_t count();
+
+        /** Forgets all strings but the empty one and frees their memory,
+         *  e.g. between batches of files in a long-running process.
+         *  Shall be called only while no other thread uses atoms and 
+         *  no atom but Atom() is kept (in an AST, a FlatAst or elsewhere):
+         *  ids are given anew afterwards, so old atoms would refer 
+         *  to other strings or to none at all.
+         */
+        static void clear();
+};
+
+std::ostream& operator<<(std::ostream& out, Atom atom);
+
+namespace std {
+    template <>
+    struct hash<Atom> {
+        size_t operator()(Atom atom) const { return atom.id(); }
+    };
+}
+
+#endif
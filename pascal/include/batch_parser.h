@@ -0,0 +1,62 @@
+#ifndef BATCH_PARSER_H
+#define BATCH_PARSER_H
+
+#include "pascal_grammar.h"
+#include "source.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Outcome of parsing one source of a batch
+struct BatchResult {
+    std::string name;  ///< path of the file or name given to the buffer
+    PNode ast;         ///< null if the source couldn't be parsed
+    std::string error; ///< what() of the exception which stopped the parse if #ast is null
+    size_t bytes;
+    size_t tokens;
+    double seconds;    ///< wall time spent on the source, mapping included
+
+    BatchResult() : bytes(0), tokens(0), seconds(0) {}
+};
+
+/// Parses many Pascal sources at once with PascalGrammar::parse.
+/** Sources are split between worker threads, each having its own queue.
+ *  Queues are filled so that larger sources are parsed first, and a
+ *  worker which has emptied its queue takes work from the others,
+ *  so that one large file doesn't keep the batch running alone.
+ */
+class BatchParser {
+        struct Source {
+            std::string name;
+            StringRef text; ///< empty for files, they are mapped by the worker
+            bool is_file;
+            size_t size;
+        };
+        std::vector<Source> sources;
+        unsigned threads;
+
+        void parse_one(const Source& source, BatchResult& result) const;
+
+    public:
+        /// 0 threads means as many as the hardware runs at once
+        explicit BatchParser(unsigned threads = 0);
+
+        /// A file which can't be read is reported in its result by #run
+        void add_file(const std::string& path);
+
+        /// \a text must stay valid until #run returns
+        void add_buffer(const std::string& name, StringRef text);
+
+        size_t size() const;
+
+        /** Parses everything added so far. Errors don't stop the batch,
+         *  they are reported in the result of the source; results are
+         *  in the order in which sources were added.
+         *  Names in the ASTs are atoms, which stay interned after 
+         *  the results are dropped until Atom::clear is called.
+         */
+        std::vector<BatchResult> run() const;
+};
+
+#endif
@@ -0,0 +1,140 @@
+#ifndef FLAT_AST_H
+#define FLAT_AST_H
+
+#include <memory>
+#include <vector>
+#include <string>
+#include <cstdint>
+
+#include "string_ref.h"
+#include "atom.h"
+#include "node_tags.h"
+#include "node_fwd.h"
+
+typedef std::shared_ptr<Node> PNode;
+
+/// Handle of a node of a FlatAst, which is its index in preorder
+typedef uint32_t NodeId;
+
+/// An AST stored column-wise in arrays indexed by NodeId.
+/** Nodes are laid out in preorder: the children of a node follow it,
+ *  each one followed by its own subtree, and the only link kept is
+ *  the end of the subtree of each node. Thus a pass which looks at
+ *  every node scans the arrays from the beginning to the end, e.g.
+ *
+ *      for (NodeId i = 0; i < ast.size(); ++i)
+ *          if (ast.is<IdentifierNode>(i)) ... ast.atom(i) ...
+ *
+ *  and children are found without following pointers (see #children).
+ *
+ *  Tags are those of node_traits, so is<T>() and tag() compare with
+ *  the tags of the Node hierarchy. Names, numbers and other values
+ *  of nodes are kept in side tables or in #payload (see the accessors);
+ *  names are atoms, whose ids are the payloads of the nodes they name;
+ *  numbers keep where they were in the text, like their nodes.
+ *  Other nodes don't know where they are in the text, so they have no spans.
+ */
+class FlatAst {
+        std::vector<uint16_t> tags_;
+        std::vector<NodeId> ends_;       ///< index after the subtree of each node
+        std::vector<uint32_t> payloads_; ///< see #payload
+
+        std::vector<std::string> names_;
+
+        struct Number {
+            uint64_t integer;
+            double real;
+            size_t position, length;
+        };
+        std::vector<Number> numbers_;
+
+        struct Builder;
+
+    public:
+        static const NodeId NO_NODE = 0xFFFFFFFFu;
+
+        /** Copies the tree under \a root; doesn't recurse, so trees
+         *  of any depth are copied. Throws std::length_error if
+         *  there are more than 2^32 - 1 nodes.
+         */
+        explicit FlatAst(const PNode& root);
+
+        size_t size() const;
+
+        /// Tag of each node, for scanning; the root is the first one
+        const std::vector<uint16_t>& tags() const;
+
+        size_t tag(NodeId i) const;
+
+        template <typename N>
+        bool is(NodeId i) const {
+            return tags_[i] == node_traits::get_tag_value<N>();
+        }
+
+        /// Index after the last node of the subtree of \a i
+        NodeId end(NodeId i) const;
+
+        /// First child of \a i or NO_NODE
+        NodeId first_child(NodeId i) const;
+
+        /// Child of the node whose subtree ends at \a parent_end after \a i, or NO_NODE
+        NodeId next_sibling(NodeId i, NodeId parent_end) const;
+
+        /// Number of children of \a i
+        size_t arity(NodeId i) const;
+
+        /// Children of a node, in the order of the fields or elements
+        class Children {
+                const FlatAst* ast;
+                NodeId first, last;
+            public:
+                Children(const FlatAst* ast, NodeId parent);
+
+                class iterator {
+                        const FlatAst* ast;
+                        NodeId i;
+                    public:
+                        iterator(const FlatAst* ast, NodeId i) : ast(ast), i(i) {}
+                        NodeId operator*() const { return i; }
+                        iterator& operator++() { i = ast -> ends_[i]; return *this; }
+                        bool operator!=(const iterator& other) const { return i != other.i; }
+                        bool operator==(const iterator& other) const { return i == other.i; }
+                };
+
+                iterator begin() const { return iterator(ast, first); }
+                iterator end() const { return iterator(ast, last); }
+        };
+
+        Children children(NodeId i) const;
+
+        /** Value of \a i which isn't a node: the operator of an OperationNode,
+         *  the sign of a SignNode, IntegerNumberNode or RealNumberNode,
+         *  the direction of a ForStatementNode as 1 or -1 cast to uint32_t,
+         *  the id of the name of a node which has one (see #atom),
+         *  and for other nodes an index in a side table or 0.
+         */
+        uint32_t payload(NodeId i) const;
+
+        /** Name of an IdentifierNode, ProcedureHeadingNode, FunctionHeadingNode,
+         *  FunctionIdentificationNode or ProgramHeadingNode
+         */
+        Atom atom(NodeId i) const;
+
+        /// String of a StringNode or message of an ErrorNode
+        const std::string& name(NodeId i) const;
+
+        /// Value of a UIntegerNumberNode
+        uint64_t integer(NodeId i) const;
+
+        /// Value of a URealNumberNode
+        double real(NodeId i) const;
+
+        /// Where a UIntegerNumberNode or URealNumberNode is in the text it was parsed from
+        size_t position(NodeId i) const;
+        size_t length(NodeId i) const;
+
+        /// Memory taken by the arrays and side tables, strings excluded
+        size_t bytes() const;
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef INCREMENTAL_PARSER_H
+#define INCREMENTAL_PARSER_H
+
+#include "pascal_grammar.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+/// Replacement of \a removed characters at \a offset with \a inserted
+struct TextEdit {
+    size_t offset;
+    size_t removed;
+    std::string inserted;
+};
+
+/// Keeps the AST of a program up to date while its text is edited.
+/** An edit inside a procedure or function reparses only the innermost
+ *  routine containing it, and the new node takes the place of the old one;
+ *  the rest of the AST is kept as it is. Edits outside of routines, and
+ *  edits after which the routine doesn't parse on its own, make
+ *  the whole program be parsed again.
+ *
+ *  The AST is changed in place by #edit; positions kept by number
+ *  nodes are those in the text each routine was parsed from, and
+ *  aren't updated by edits elsewhere. A reparsed routine owns the
+ *  NodeArena of its nodes, while the nodes it replaced stay in the arena
+ *  of the last full parse until the next one frees it.
+ */
+class IncrementalParser {
+        std::string text_;
+        PNode ast_; ///< null if the text is invalid
+
+        std::vector<RoutineSpan> routines; ///< in #text_, ordered by RoutineSpan::begin
+
+        void parse_all();
+        /// Index in #routines of the innermost routine strictly containing \a edit, or -1
+        long innermost(const TextEdit& edit) const;
+        bool reparse(size_t index, const TextEdit& edit);
+
+    public:
+        /// Throws SyntaxError like PascalGrammar::parse
+        explicit IncrementalParser(std::string text);
+
+        const std::string& text() const;
+        const PNode& ast() const;
+
+        /** Applies \a edit to the text and updates the AST.
+         *  Returns true if a single routine was reparsed, false if
+         *  the whole program was. If the edited program is invalid,
+         *  throws SyntaxError and #ast is null until an edit makes it valid.
+         */
+        bool edit(const TextEdit& edit);
+};
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef LIST_MODE_H
+#define LIST_MODE_H
+
+#include "pascal_grammar.h"
+#include "node_traits.h"
+#include "ast_visitors.h"
+
+template <typename T>
+void PascalGrammar::set_list(Mode<PNode>& mode, Symbol<PNode>* sym, std::string desc) {
+    PascalGrammar* g = this;
+    set_behaviour<List>(mode, *sym, [g, desc](std::vector<PNode>&& operands) {
+        return ListVisitor<T>(operands, g, desc).get_expression(); 
+    });
+}
+
+#endif
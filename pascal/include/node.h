@@ -2,12 +2,15 @@
 #define NODE_H
 
 #include <memory>
-#include <forward_list>
 #include <string>
+#include <cstdint>
 
+#include "string_ref.h"
 #include "node_tags.h"
 #include "node_fwd.h"
+#include "node_list.h"
 #include "operator.h"
+#include "atom.h"
 
 struct Node {
     virtual ~Node();
@@ -25,11 +28,11 @@ struct VisitableNode : public Node {
 
 template <typename T>
 struct ListOf : public VisitableNode<ListOf<T>> {
-    typedef std::forward_list<PNode> ListT;
+    typedef NodeList ListT;
     ListOf() {}
-    ListOf(ListT&& lst) : lst(lst) {}
+    ListOf(ListT&& lst) : lst(std::move(lst)) {}
     ListOf(const PNode& node) {
-        lst.push_front(node);
+        lst.push_back(node);
     }
     ListT& list() { return lst; }
 private:
@@ -38,8 +41,14 @@ private:
 
 struct EmptyNode : public VisitableNode<EmptyNode> {};
 
+/// Stands for tokens skipped after a syntax error, see PascalGrammar::parse_with_recovery
+struct ErrorNode : public VisitableNode<ErrorNode> {
+    std::string message;
+    ErrorNode(const std::string& message);
+};
+
 struct OperationNode : public VisitableNode<OperationNode> {
-    std::forward_list<PNode> args;
+    NodeList args;
 
     OperationNode(int arity, Operator op);
 
@@ -59,15 +68,24 @@ struct SignNode : public VisitableNode<SignNode> {
         char _sign;
 };
 
+/* Numbers are decoded by the lexer (see pascal::decode_number).
+   The position and length are those of the literal in the text 
+   it was parsed from, which the node doesn't refer to. */
+
 struct UIntegerNumberNode : public VisitableNode<UIntegerNumberNode> {
-    std::string value;
-    UIntegerNumberNode(std::string value);
+    uint64_t value;
+    size_t position, length;
+    UIntegerNumberNode(uint64_t value, size_t position, size_t length);
 };
 
 struct URealNumberNode : public VisitableNode<URealNumberNode> {
-    std::string significand;
-    std::string exponent;
-    URealNumberNode(std::string significand, std::string exponent="0");
+    double value;
+    size_t position, length;
+    URealNumberNode(double value, size_t position, size_t length);
+
+    /// Shortest digits of value with a point after the first one, see pascal::format_real
+    std::string significand() const;
+    int exponent() const;
 };
 
 struct IntegerNumberNode : public VisitableNode<IntegerNumberNode> {
@@ -82,9 +100,14 @@ struct RealNumberNode : public VisitableNode<RealNumberNode> {
     RealNumberNode(const PNode& value, char sign='+');
 };
 
+/* Names are compared regardless of case, so the atom is that of 
+   the name in lower case; the spelling is the name as it is written 
+   in the program, interned as well so that the node doesn't refer to it. */
+
 struct IdentifierNode : public VisitableNode<IdentifierNode> {
-    std::string name;
-    IdentifierNode(std::string s);
+    Atom name;
+    Atom spelling;
+    IdentifierNode(Atom name, Atom spelling);
 };
 
 struct StringNode : public VisitableNode<StringNode> { 
@@ -323,9 +346,9 @@ struct ValueParameterNode : public VisitableNode<ValueParameterNode> {
 };
 
 struct ProcedureHeadingNode : public VisitableNode<ProcedureHeadingNode> {
-    std::string name;
+    Atom name;
     PNode params;
-    ProcedureHeadingNode(const std::string& name, const PNode& params);
+    ProcedureHeadingNode(Atom name, const PNode& params);
 };
 
 struct ParameterNode : public VisitableNode<ParameterNode> {
@@ -334,15 +357,15 @@ struct ParameterNode : public VisitableNode<ParameterNode> {
 };
 
 struct FunctionHeadingNode : public VisitableNode<FunctionHeadingNode> {
-    std::string name;
+    Atom name;
     PNode params;
     PNode return_type;
-    FunctionHeadingNode(const std::string& n, const PNode& p, const PNode& r);
+    FunctionHeadingNode(Atom n, const PNode& p, const PNode& r);
 };
 
 struct FunctionIdentificationNode : public VisitableNode<FunctionIdentificationNode> {
-    std::string name;
-    FunctionIdentificationNode(const std::string& name);
+    Atom name;
+    FunctionIdentificationNode(Atom name);
 };
 
 struct ProcedureNode : public VisitableNode<ProcedureNode> {
@@ -437,10 +460,10 @@ struct GotoStatementNode : public VisitableNode<GotoStatementNode> {
 };
 
 struct ProgramHeadingNode : public VisitableNode<ProgramHeadingNode> {
-    std::string name;
+    Atom name;
     PNode files;
-    ProgramHeadingNode(const std::string& name, const PNode& files);
-    ProgramHeadingNode(const std::string& name);
+    ProgramHeadingNode(Atom name, const PNode& files);
+    ProgramHeadingNode(Atom name);
 };
 
 struct ProgramNode : public VisitableNode<ProgramNode> {
@@ -0,0 +1,111 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <memory>
+#include <vector>
+#include <new>
+#include <utility>
+#include <cstddef>
+
+#include "node_fwd.h"
+
+typedef std::shared_ptr<Node> PNode;
+
+/// Memory which the nodes of one parse are allocated from.
+/** Nodes are placed one after another in large blocks instead of
+ *  each having its own allocation and reference count. PNodes made
+ *  by #make_node while an arena is current don't own the node they
+ *  point to, so copying them is as cheap as copying a pointer; only
+ *  PNodes sharing the handle returned by #make (see #share_node) keep
+ *  the arena alive. It is freed by destroying its nodes in a single
+ *  loop, however deep the tree is, and dropping its blocks.
+ */
+class NodeArena {
+        std::vector<std::unique_ptr<char[]>> blocks;
+        char* next;  ///< free space of the last block
+        size_t left; ///< bytes left in it
+        size_t bytes_;
+
+        std::vector<Node*> nodes; ///< in the order of construction
+
+        static thread_local NodeArena* current_;
+
+        NodeArena();
+
+        void* allocate(size_t size, size_t alignment);
+
+    public:
+        /// Size of the first block; each next one is twice as large, up to MAX_BLOCK
+        static const size_t BLOCK = 16 * 1024;
+        static const size_t MAX_BLOCK = 1024 * 1024;
+
+        ~NodeArena();
+        NodeArena(const NodeArena&) = delete;
+        NodeArena& operator=(const NodeArena&) = delete;
+
+        /// Creates an arena, which lives as long as the handle and PNodes sharing it
+        static std::shared_ptr<NodeArena> make();
+
+        /// Constructs a node of type N in the arena
+        template <typename N, typename... Args>
+        N* create(Args&&... args) {
+            nodes.push_back(nullptr); // so that the node is destroyed whatever throws
+            try {
+                N* node = new (allocate(sizeof(N), alignof(N))) N(std::forward<Args>(args)...);
+                nodes.back() = node;
+                return node;
+            } catch (...) {
+                nodes.pop_back();
+                throw;
+            }
+        }
+
+        /// Number of nodes created
+        size_t size() const;
+
+        /// Bytes taken by the nodes, alignment included
+        size_t bytes() const;
+
+        /// Arena which #make_node uses in this thread, null if there is none
+        static NodeArena* current();
+
+        /** Makes an arena current in the thread until destroyed;
+         *  the handle of the arena shall be kept alive meanwhile.
+         */
+        class Scope {
+                NodeArena* outer;
+            public:
+                explicit Scope(NodeArena* arena);
+                ~Scope();
+                Scope(const Scope&) = delete;
+                Scope& operator=(const Scope&) = delete;
+        };
+};
+
+/** Creates a node in the current arena, returning a pointer which
+ *  doesn't own it, or by std::make_shared if there is no current arena.
+ */
+template <typename N, typename... Args>
+std::shared_ptr<N> make_node(Args&&... args) {
+    NodeArena* arena = NodeArena::current();
+    if (arena == nullptr)
+        return std::make_shared<N>(std::forward<Args>(args)...);
+    return std::shared_ptr<N>(std::shared_ptr<N>(),
+                              arena -> create<N>(std::forward<Args>(args)...));
+}
+
+/** Pointer to \a node which keeps it alive as long as \a owner does,
+ *  \a owner being e.g. the root returned by PascalGrammar::parse or
+ *  the handle of the arena. A subtree which may outlive the root 
+ *  of its AST shall be kept this way rather than as a copy of the 
+ *  PNode found in the tree, which doesn't own the node.
+ */
+template <typename N, typename Owner>
+std::shared_ptr<N> share_node(const std::shared_ptr<Owner>& owner, 
+                              const std::shared_ptr<N>& node) {
+    if (!node || node.use_count() != 0)
+        return node; // owns its node already
+    return std::shared_ptr<N>(owner, node.get());
+}
+
+#endif
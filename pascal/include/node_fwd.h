@@ -6,6 +6,7 @@ struct Node;
 template <typename T> struct ListOf;
 
 struct EmptyNode;
+struct ErrorNode;
 
 struct UIntegerNumberNode;
 struct IntegerNumberNode;
@@ -0,0 +1,77 @@
+#ifndef NODE_LIST_H
+#define NODE_LIST_H
+
+#include <memory>
+#include <type_traits>
+#include <cstddef>
+
+#include "node_fwd.h"
+
+typedef std::shared_ptr<Node> PNode;
+
+/// Contiguous sequence of nodes which keeps up to INLINE of them in itself.
+/** Like std::vector, but nodes are added at either end in amortized
+ *  constant time: when one end runs out of room, the storage is
+ *  reallocated with as much room at that end as there are nodes,
+ *  keeping the room at the other one.
+ */
+class NodeList {
+    public:
+        static const size_t INLINE = 2;
+
+    private:
+        PNode* storage;  ///< #buffer or allocated
+        size_t capacity; ///< of the storage
+        PNode* first;
+        PNode* last;     ///< nodes are constructed in [first, last)
+
+        std::aligned_storage<sizeof(PNode), alignof(PNode)>::type buffer[INLINE];
+
+        bool is_inline() const;
+
+        /// Moves the nodes into new storage with the given room around them
+        void reallocate(size_t front, size_t back);
+
+        /// Destroys the nodes and frees the storage, leaving the object invalid
+        void release();
+
+        /// Takes nodes of \a other, which must be empty or valid, leaving it empty
+        void take(NodeList& other);
+
+    public:
+        typedef PNode value_type;
+        typedef PNode* iterator;
+        typedef const PNode* const_iterator;
+
+        NodeList();
+        NodeList(const NodeList& other);
+        NodeList(NodeList&& other);
+        NodeList& operator=(const NodeList& other);
+        NodeList& operator=(NodeList&& other);
+        ~NodeList();
+
+        size_t size() const { return last - first; }
+        bool empty() const { return first == last; }
+
+        iterator begin() { return first; }
+        iterator end() { return last; }
+        const_iterator begin() const { return first; }
+        const_iterator end() const { return last; }
+        const_iterator cbegin() const { return first; }
+        const_iterator cend() const { return last; }
+
+        PNode& operator[](size_t i) { return first[i]; }
+        const PNode& operator[](size_t i) const { return first[i]; }
+        PNode& front() { return *first; }
+        PNode& back() { return last[-1]; }
+
+        void push_back(PNode node);
+        void push_front(PNode node);
+
+        /// Makes room for \a count nodes at the back
+        void reserve(size_t count);
+
+        void clear();
+};
+
+#endif
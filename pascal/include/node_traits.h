@@ -6,6 +6,7 @@
 
 //#include "node.h"
 #include "node_fwd.h"
+#include "node_arena.h"
 #include "visitor.h"
 //#include "node_tags.h"
 #include "utils.h"
@@ -19,6 +20,7 @@ namespace node_traits {
     namespace visitors {
         using utils::type;
 
+        /// Keeps the result of a visit, so its instances are per thread (see below)
         struct TraitsVisitor : public AstIgnoreVisitor {
             using AstIgnoreVisitor::visit;
             bool operator()(const PNode& node) {
@@ -123,10 +125,12 @@ namespace node_traits {
             UIntegerNumberNode, URealNumberNode, 
             IntegerNumberNode,  RealNumberNode> IsNumber;
 
+        /* ErrorNode stands for a literal which couldn't be decoded,
+           see PascalGrammar::check_literals */
         typedef AreConvertibleTo< ExpressionNode,
             flatten< IsNumber::list, IsVar::list,
                 OperationNode, StringNode, SetNode, SignNode, 
-                FunctionDesignatorNode>::list> IsExpr;
+                FunctionDesignatorNode, ErrorNode>::list> IsExpr;
 
         typedef ConversionTable<
             IsIndexType, IsVar, IsExpr,
@@ -141,7 +145,8 @@ namespace node_traits {
                 IfThenNode, IfThenElseNode, CompoundStatementNode, ForStatementNode,
                 WhileStatementNode, RepeatStatementNode, WriteNode, WriteLineNode,
                 FunctionDesignatorNode, LabeledStatementNode, AssignmentStatementNode,
-                WithStatementNode, CaseStatementNode, GotoStatementNode, EmptyNode>,
+                WithStatementNode, CaseStatementNode, GotoStatementNode, EmptyNode,
+                ErrorNode>,
 
             AreConvertibleTo< ParameterNode,
                 VariableParameterNode, ValueParameterNode, 
@@ -150,7 +155,7 @@ namespace node_traits {
             AreConvertibleTo< DeclarationNode,
                 VariableSectionNode, TypeSectionNode, ConstSectionNode,
                 FunctionNode, FunctionForwardDeclNode, FunctionIdentificationNode,
-                ProcedureNode, ProcedureForwardDeclNode, LabelSectionNode>,
+                ProcedureNode, ProcedureForwardDeclNode, LabelSectionNode, ErrorNode>,
 
             AreConvertibleTo< ProgramHeadingNode, IdentifierNode>
                                > conversions;
@@ -177,8 +182,8 @@ namespace node_traits {
                 bool operator()(const PNode& node) {
                     typedef AreConvertibleTo<ConstantNode,
                         flatten< IsNumber::list, IdentifierNode>::list> IsNumConst;
-                    static IsNumConst is_num_const;
-                    static AreConvertibleTo<ConstantNode,
+                    static thread_local IsNumConst is_num_const;
+                    static thread_local AreConvertibleTo<ConstantNode,
                         flatten< IsNumConst::list, StringNode>::list> is_surely_constant;
                     return is_surely_constant(node) ||
                            ( has_type<SignNode>(node) &&
@@ -189,12 +194,13 @@ namespace node_traits {
 
     } // namespace detail
 
-    static detail::IsUnsignedNumber is_unsigned_number;
-    static detail::IsNumber is_number;
-    static detail::IsUST is_unpacked_structured_type;
-    static detail::IsType is_type;
-    static detail::IsConformantArraySchema is_conformant_array_schema;
-    static detail::IsParamType is_parameter_type;
+    /* one instance per thread, see TraitsVisitor */
+    static thread_local detail::IsUnsignedNumber is_unsigned_number;
+    static thread_local detail::IsNumber is_number;
+    static thread_local detail::IsUST is_unpacked_structured_type;
+    static thread_local detail::IsType is_type;
+    static thread_local detail::IsConformantArraySchema is_conformant_array_schema;
+    static thread_local detail::IsParamType is_parameter_type;
 
     template <typename _Node> struct there_exist_coercions_to { 
         enum { value = detail::conversions::has_key<_Node>::value }; 
@@ -206,7 +212,7 @@ namespace node_traits {
     bool is_convertible_to(const PNode& node) { 
         if (node -> tag() == node_traits::get_tag_value<_Node>())
             return true;
-        static typename detail::is_convertible_helper<
+        static thread_local typename detail::is_convertible_helper<
             _Node, there_exist_coercions_to<_Node>::value>::type checker;
         return checker(node);
     }
@@ -226,7 +232,7 @@ namespace node {
     template <typename T>
     std::shared_ptr<typename node_traits::list_of<T>::type> 
     make_list(const std::shared_ptr<T>& node) {
-        return std::make_shared<typename node_traits::list_of<T>::type>(node);
+        return make_node<typename node_traits::list_of<T>::type>(node);
     }
 
     /** If node runtime type is T returns std::static_pointer_cast to T.
@@ -236,7 +242,7 @@ namespace node {
     std::shared_ptr<T> convert_to(const PNode& node) {
         if (node_traits::has_type<T>(node))
             return std::static_pointer_cast<T>(node);
-        return std::make_shared<T>(node);
+        return make_node<T>(node);
     }
 
 } // namespace node
@@ -2,22 +2,40 @@
 #define PASCAL_GRAMMAR_H
 
 #include "parser.h"
+#include "skip_white_space.h"
 
 #include "pascal_handlers.h"
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <functional>
+#include <stdexcept>
 
 #include "operator.h"
 #include "node_fwd.h"
+#include "node_arena.h"
+#include "syntax_error.h"
 
 class PascalGrammar;
 typedef std::shared_ptr<Node> PNode;
 
+/// Where a procedure or function with a body is in the text
+struct RoutineSpan {
+    size_t begin;   ///< position of 'procedure' or 'function'
+    size_t end;     ///< position after the ';' which ends the declaration
+    unsigned depth; ///< number of routines it is nested in
+    PNode node;     ///< ProcedureNode or FunctionNode, keeps the nodes of the AST alive
+};
+
+/// Result of PascalGrammar::parse_with_recovery
+struct ParseResult {
+    PNode ast; ///< has an ErrorNode in place of each part which couldn't be parsed
+    std::vector<Diagnostic> diagnostics; ///< ordered by position
+};
+
 namespace pascal_grammar {
     namespace detail {
-        struct bound_specification_guard;
         template <typename ExprType> struct ExpressionListParser;
         PNode parse_formal_parameter_list(PrattParser<PNode>&, PascalGrammar&);
     }
@@ -35,7 +53,6 @@ class PascalGrammar : public grammar::Grammar<PNode> {
     friend void pascal_grammar::add_procedures_and_functions(PascalGrammar&);
     friend PNode pascal_grammar::detail::parse_formal_parameter_list
                                        (PrattParser<PNode>&, PascalGrammar&);
-    friend struct pascal_grammar::detail::bound_specification_guard;
     friend struct pascal_grammar::detail::ExpressionListParser<ExpressionNode>;
     friend struct pascal_grammar::detail::ExpressionListParser<SetExpressionNode>;
 
@@ -43,7 +60,120 @@ class PascalGrammar : public grammar::Grammar<PNode> {
                   *colon, *opening_bracket, *end,
                   *range, *array, *packed, *var, *dot;
 
-    std::unique_ptr<PrattParser<PNode>> parser;
+    /* symbols which handlers only compare the next token with;
+       a trailing underscore avoids clashes with C++ keywords */
+    Symbol<PNode> *closing_bracket, *opening_square_bracket, *closing_square_bracket,
+                  *begin, *of, *then, *else_, *do_, *to, *downto, *until, *case_,
+                  *procedure, *function, *type_, *label, *const_;
+
+    /* modes entered by handlers, see Mode; 
+       each add_* function sets up the modes of its own handlers */
+    struct {
+        Mode<PNode> program_heading;
+        Mode<PNode> enumerated_type, variable_section, type_section, 
+                    constant_section, label_section;
+        Mode<PNode> field_list, variant_part, index_types;
+        Mode<PNode> set_constructor, expression_list, set_expression_list;
+        Mode<PNode> statement, compound_statement, with_statement, 
+                    case_statement, output_list;
+        Mode<PNode> bound_specification, formal_parameters, 
+                    procedure_heading, function_heading;
+    } modes;
+
+    /// State of a single call of #parse; the grammar itself isn't changed by parsing
+    struct Session {
+        /// Nodes of the parse, null if another arena is current
+        std::shared_ptr<NodeArena> arena;
+        NodeArena::Scope in_arena;
+        TokenStream<PNode> tokens;
+        PrattParser<PNode> parser; ///< keeps the modes entered, see Mode
+        Session* outer; ///< session which was current in the thread before this one
+
+        /// Where errors are collected by #parse_with_recovery, null if they are thrown
+        std::vector<Diagnostic>* diagnostics;
+
+        /// Where routines are recorded as they are parsed, null if they aren't needed
+        std::vector<RoutineSpan>* routines;
+
+        /// Becomes the current session of the thread until destroyed
+        Session(StringRef program, const SymbolDict<PNode>& symbols,
+                std::vector<Diagnostic>* diagnostics = nullptr);
+        ~Session();
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+        /// \a node, which is returned by the parse, made to own #arena (see share_node)
+        PNode own(const PNode& node) const;
+    };
+
+    /// Session of the parse running in this thread
+    static thread_local Session* session;
+
+    /// Parser of the current session
+    PrattParser<PNode>& parser() const;
+
+    /// true in #parse_with_recovery
+    bool collects_errors() const;
+
+    /// Tells about an unclosed comment or string if \a position is inside it
+    std::string unclosed(const SourcePosition& position) const;
+
+    /// Adds \a description at the position of the next token to the collected errors
+    void report(const std::string& description) const;
+    /// Same, at \a position in the program
+    void report(const std::string& description, size_t position) const;
+
+    /** Skips tokens after an error up to a semicolon, 'end', 'begin',
+     *  a keyword starting a section or the end of the program.
+     *  At least one token is skipped if the error occurred at \a start.
+     */
+    PNode resync(size_t start) const;
+
+    /** Returns parse(). When errors are collected, an error in it 
+     *  has stopped the parser (see #error), which is resumed here, and 
+     *  the tokens up to a synchronizing one are replaced with an ErrorNode, 
+     *  see #resync. Nothing is parsed if the parser is stopped already:
+     *  the error is recovered from by an outer call.
+     */
+    template <typename F>
+    PNode recover(F parse) const {
+        if (session -> diagnostics == nullptr)
+            return parse();
+        PrattParser<PNode>& p = parser();
+        if (p.stopped())
+            return p.stop_value();
+        size_t start = p.next_token().start_position;
+        try {
+            PNode node = parse();
+            if (!p.stopped())
+                return node;
+        } catch (ParseError& e) { // those still thrown, e.g. by Token::nud
+            error(e.description(), e.position());
+        } catch (std::runtime_error& e) { // e.g. by the lexer
+            error(e.what());
+        }
+        p.resume();
+        return resync(start);
+    }
+
+    /// The only instance, built by the first call
+    static const PascalGrammar& instance();
+
+    /// Parses declarations and blocks of the current session
+    struct BlockParser;
+
+    /** Reports the first literal of the current session which couldn't
+     *  be decoded, e.g. an integer which doesn't fit into 64 bits; when
+     *  errors are collected, reports all of them, and each stays in the
+     *  AST as an ErrorNode. Called before parsing.
+     */
+    void check_literals() const;
+
+    /// Parses the program of the current session
+    static PNode parse_program();
+
+    /// Sorts \a routines recorded by a session by position and sets their depth
+    static void nest(std::vector<RoutineSpan>& routines);
 
     PascalGrammar();
     PascalGrammar(const PascalGrammar&) = delete;
@@ -52,15 +182,63 @@ class PascalGrammar : public grammar::Grammar<PNode> {
     PascalGrammar& operator=(PascalGrammar&&) = delete;
 
 public:
-    static PNode parse(const std::string&);
-    void error(const std::string&) const;
-    void advance(const std::string&, const std::string&);
+    /// Symbols of the only instance, e.g. for lexing a program without parsing it
+    static const SymbolDict<PNode>& dictionary();
+
+    /** Parses \a program with the only instance of the grammar, 
+     *  which is built by the first call. Different threads may parse 
+     *  at the same time: the grammar is only read, and everything a parse
+     *  changes is kept in its Session. If \a tokens isn't null,
+     *  it receives the number of tokens \a program was split into,
+     *  even when a syntax error is thrown. The whole program shall be 
+     *  in memory and shorter than 4 GB (see TokenStream); it can't be 
+     *  read by ChunkedReader.
+     *
+     *  Nodes are allocated in a NodeArena; only the returned root owns
+     *  them, pointers to other nodes are valid as long as it is alive 
+     *  (see share_node). If an arena is already current in the thread 
+     *  (see NodeArena::Scope), nodes are allocated in it instead, 
+     *  and the root doesn't own them.
+     *  Nodes don't refer to \a program, so it needn't outlive the AST;
+     *  number nodes only keep their position and length in it.
+     */
+    static PNode parse(StringRef program, size_t* tokens = nullptr);
+
+    /** Same as #parse, but doesn't stop at the first syntax error:
+     *  each error is recorded, the parser skips to the next ';',
+     *  'end', 'begin' or section keyword and goes on, and so does
+     *  the lexer after an invalid character. Throws nothing but
+     *  std::bad_alloc.
+     */
+    static ParseResult parse_with_recovery(StringRef program, size_t* tokens = nullptr);
+
+    /// Same as #parse, also puts every routine with a body into \a routines, ordered by #begin
+    static PNode parse(StringRef program, std::vector<RoutineSpan>& routines);
+
+    /** Parses \a text which shall be a single procedure or function 
+     *  declaration with a body and the ';' after it, as if it were in 
+     *  a block. Spans put into \a routines are relative to \a text, and the 
+     *  routine itself is the first of them. Throws SyntaxError otherwise.
+     */
+    static PNode parse_routine(StringRef text, std::vector<RoutineSpan>& routines);
+
+    /** Throws SyntaxError. When errors are collected, records the error
+     *  instead, stops the parser (see PrattParser::stop) with an ErrorNode
+     *  and returns it; handlers return it in turn if they can't go on. 
+     *  Errors following from the first one aren't recorded.
+     */
+    PNode error(const std::string&) const;
+    /// Same, at \a position in the program rather than at the next token
+    PNode error(const std::string&, size_t position) const;
+    /// Skips the next token if it is \a expected, otherwise reports \a desc
+    void advance(const Symbol<PNode>& expected, const std::string& desc) const;
     
-    template <typename T> struct list_guard {
-        list_guard(PascalGrammar& g, Symbol<PNode>* sym, std::string desc);
-    private:
-        PascalGrammar::behaviour_guard<RightAssociative> guard;
-    }; // to use, include "list_guard.h"
+    /** In \a mode, \a sym separates elements of a list of T,
+     *  which are described as \a desc in error messages.
+     */
+    template <typename T> 
+    void set_list(Mode<PNode>& mode, Symbol<PNode>* sym, std::string desc); 
+    // to use, include "list_mode.h"
 };
 
 #endif
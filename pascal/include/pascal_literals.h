@@ -1,17 +1,41 @@
 #ifndef PASCAL_LITERALS_H
 #define PASCAL_LITERALS_H
 
+#include "string_ref.h"
+
 #include <string>
+#include <cstdint>
 
 namespace pascal {
-    size_t number_scanner(const std::string&, size_t);
-    std::string number_parser(const std::string&, size_t, size_t);
+    /* characters the tokens may start with, see Symbol::set_scanner */
+    extern const char number_first_chars[];
+    extern const char string_first_chars[];
+    extern const char identifier_first_chars[];
+
+    size_t number_scanner(StringRef, size_t);
+
+    /* value of a number scanned by number_scanner */
+    struct Number {
+        bool is_real;
+        const char* error; // why the number is invalid, e.g. an integer 
+                           // doesn't fit into 64 bits; null if it is valid
+        uint64_t integer;
+        double real;       // correctly rounded
+    };
+
+    /* converts [beg, end) of the string without copying it
+       in all but rare cases (see pascal_literals.cpp) */
+    Number decode_number(StringRef, size_t beg, size_t end);
+
+    /* the shortest decimal significand, with a point after the first
+       digit, and the exponent which are read back as value */
+    void format_real(double value, std::string& significand, int& exponent);
 
-    size_t string_scanner(const std::string&, size_t);
-    std::string string_parser(const std::string&, size_t, size_t);
+    size_t string_scanner(StringRef, size_t);
+    std::string string_parser(StringRef, size_t, size_t);
 
     /* scans [_\w][_\w\d]+ */
-    size_t identifier_scanner(const std::string&, size_t);
-    std::string identifier_parser(const std::string&, size_t, size_t);
+    size_t identifier_scanner(StringRef, size_t);
+    std::string identifier_parser(StringRef, size_t, size_t);
 }
 #endif
@@ -0,0 +1,67 @@
+#ifndef SIMD_SCAN_H
+#define SIMD_SCAN_H
+
+#include <cstddef>
+#include <cstdint>
+
+/* Functions used by the lexer on long runs of characters.
+   Each of them has SSE2 and AVX2 versions;
+   the best one supported by the CPU is chosen at runtime. */
+
+namespace simd {
+
+    /// Same as isspace in the "C" locale
+    inline bool is_space(char c) {
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    }
+
+    /// Character classes of the "C" locale used by the scanners
+    enum { DIGIT = 1, ALPHA = 2, UNDERSCORE = 4 };
+    extern const unsigned char char_classes[256];
+
+    inline bool is_digit(char c) {
+        return char_classes[static_cast<unsigned char>(c)] & DIGIT;
+    }
+
+    /// [_a-zA-Z]
+    inline bool is_word_start(char c) {
+        return char_classes[static_cast<unsigned char>(c)] & (ALPHA | UNDERSCORE);
+    }
+
+    /// [_a-zA-Z0-9]
+    inline bool is_word(char c) {
+        return char_classes[static_cast<unsigned char>(c)] & (DIGIT | ALPHA | UNDERSCORE);
+    }
+
+    /* skip_digits and skip_word search [pos, len) of s
+       and return len if there is no such character */
+
+    /// Returns position of the first character which is not a digit.
+    size_t skip_digits(const char* s, size_t pos, size_t len);
+
+    /// Returns position of the first character which is not [_a-zA-Z0-9].
+    size_t skip_word(const char* s, size_t pos, size_t len);
+
+    /// Bit i of each mask is set if the i-th character of a block belongs to the class.
+    struct BlockMasks {
+        uint64_t quote;       ///< '
+        uint64_t open_brace;  ///< {
+        uint64_t close_brace; ///< }
+        uint64_t open_paren;  ///< (
+        uint64_t star;        ///< *
+        uint64_t close_paren; ///< )
+        uint64_t space;       ///< see is_space
+    };
+
+    /// Classifies characters of [s, s + min(n, 64)); bits beyond n are zero.
+    void classify(const char* s, size_t n, BlockMasks& m);
+
+    /// Reference implementations, also used for the tails of the input.
+    namespace scalar {
+        size_t skip_digits(const char* s, size_t pos, size_t len);
+        size_t skip_word(const char* s, size_t pos, size_t len);
+        void classify(const char* s, BlockMasks& m); ///< exactly 64 characters
+    }
+}
+
+#endif
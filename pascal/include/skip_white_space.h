@@ -0,0 +1,28 @@
+#ifndef SKIP_WHITE_SPACE_H
+#define SKIP_WHITE_SPACE_H
+
+#include "parser.h"
+#include "structural_index.h"
+
+#include <memory>
+#include <string>
+
+struct Node;
+
+namespace token {
+
+    /// Specialization to treat {...} and (* ... *) as white space
+    /** The program is indexed once at construction (see StructuralIndex),
+     *  then white space and comments are found in the bitmaps.
+     */
+    template <>
+    struct SkipWhiteSpace<std::shared_ptr<Node>> {
+        StructuralIndex index;
+
+        SkipWhiteSpace(StringRef str);
+
+        void operator()(StringRef str, size_t& start);
+    };
+}
+
+#endif
@@ -0,0 +1,51 @@
+#ifndef STRUCTURAL_INDEX_H
+#define STRUCTURAL_INDEX_H
+
+#include "string_ref.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/// Bitmaps of the structure of a Pascal program.
+/** Built in one pass over the text, 64 characters at a time 
+ *  (see simd::classify). Bit i of a bitmap corresponds to the i-th 
+ *  character of the text.
+ *
+ *  Delimiters of comments and strings are found among the few 
+ *  characters that may be ones ({, (*, ', and the closing ones); 
+ *  a small automaton goes through them in order, carrying its state 
+ *  from one block to the next, so that e.g. '{' in a string 
+ *  doesn't start a comment and an apostrophe in a comment 
+ *  doesn't start a string.
+ *
+ *  The lexer uses #skip to jump from the end of a token
+ *  straight to the beginning of the next one.
+ */
+class StructuralIndex {
+        std::vector<uint64_t> comments; ///< {...} and (*...*) including delimiters
+        std::vector<uint64_t> strings;  ///< '...' including quotes
+        std::vector<uint64_t> skip;     ///< white space and comments outside of strings
+        size_t length;
+        size_t unterminated_; ///< see #unterminated
+
+        bool test(const std::vector<uint64_t>& bitmap, size_t pos) const;
+    public:
+        StructuralIndex(StringRef text);
+
+        /// Returns the first position >= \a pos which is not white space 
+        /// or comment, or the length of the text.
+        size_t next_token_start(size_t pos) const;
+
+        bool in_comment(size_t pos) const;
+        bool in_string(size_t pos) const;
+
+        /** Position of the beginning of a comment or a string 
+         *  which isn't closed until the end of the text 
+         *  or std::string::npos
+         */
+        size_t unterminated() const;
+};
+
+#endif
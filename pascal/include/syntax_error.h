@@ -4,6 +4,8 @@
 #include <exception>
 #include <string>
 
+#include "line_index.h"
+
 struct SyntaxError : public std::exception {
     SyntaxError(const char* str) : message(str) {}
     SyntaxError(const std::string& str) : message(str) {}
@@ -16,4 +18,10 @@ struct SyntaxError : public std::exception {
         std::string message;
 };
 
+/// Syntax error recorded without stopping the parse
+struct Diagnostic {
+    SourcePosition position;
+    std::string message;
+};
+
 #endif
@@ -20,10 +20,12 @@ private:
 public:
     PPrintPreprocessor(const string& input_file_name) : Grammar<string>("(end)") {
 
-        add_symbol_to_dict("(string literal)", 0).set_scanner(pascal::string_scanner)
+        add_symbol_to_dict("(string literal)", 0).set_scanner(pascal::string_scanner,
+                                                              pascal::string_first_chars)
                                                  .set_parser(pascal::string_parser);
 
-        add_symbol_to_dict("(identifier)", 0).set_scanner(pascal::identifier_scanner)
+        add_symbol_to_dict("(identifier)", 0).set_scanner(pascal::identifier_scanner,
+                                                          pascal::identifier_first_chars)
                                              .set_parser(pascal::identifier_parser);
 
         infix("->", 10, [this](string node_name, string body) -> string {
@@ -49,7 +51,7 @@ public:
                 return "{ int old_indent = indent;\nindent = 0;\n" + s + "indent = old_indent;\n" + '}'; });
                        
         add_symbol_to_dict("visit_children", 50)
-        .set_parser([](const std::string&, size_t, size_t) {
+        .set_parser([](StringRef, size_t, size_t) {
                 return "for (auto it = e -> list().begin(); it != e -> list().end(); ++it)"
                        "travel(*it);\n";
                 });
@@ -0,0 +1,257 @@
+#include "atom.h"
+
+#include <atomic>
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <ostream>
+#include <stdexcept>
+#include <cstring>
+#include <algorithm>
+
+namespace {
+
+    /* Most identifiers are shorter than a vector register, so rather
+       than with SSE, characters are folded and hashed 8 at a time
+       as bytes of a 64-bit word. */
+
+    const uint64_t ONES = 0x0101010101010101ull;
+
+    /// Up to 8 characters of \a s, zero-padded
+    inline uint64_t load_word(const char* s, size_t n) {
+        uint64_t word = 0;
+        std::memcpy(&word, s, n);
+        return word;
+    }
+
+    /// Folds A-Z to a-z in each byte of \a word
+    inline uint64_t fold_word(uint64_t word) {
+        uint64_t low = word & (ONES * 0x7F);
+        uint64_t from_a = low + ONES * (0x80 - 'A');     // bit 7 set if >= 'A'
+        uint64_t after_z = low + ONES * (0x80 - 'Z' - 1); // bit 7 set if > 'Z'
+        uint64_t upper = from_a & ~after_z & ~word & (ONES * 0x80);
+        return word | upper >> 2;
+    }
+
+    inline void mix(uint64_t& hash, uint64_t word) {
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDull;
+        hash ^= hash >> 29;
+    }
+
+    uint64_t hash_words(const char* s, size_t n) {
+        uint64_t hash = 0x9E3779B97F4A7C15ull ^ n;
+        for ( ; n >= 8; s += 8, n -= 8)
+            mix(hash, load_word(s, 8));
+        if (n > 0)
+            mix(hash, load_word(s, n));
+        return hash ^ hash >> 32;
+    }
+
+    /* Strings are copied into blocks of characters, each one preceded
+       by its length, and found by their ids in chunks of 2^10, 2^11, ...
+       pointers; ids are taken from a counter. The hash table which finds
+       ids of strings is split into shards locked separately, each with
+       its own blocks, so that threads parsing at the same time rarely wait. */
+
+    const unsigned SHARD_BITS = 4;
+    const unsigned FIRST_CHUNK_BITS = 10;
+    const unsigned CHUNKS = 32 - FIRST_CHUNK_BITS;
+    const uint32_t NO_ATOM = 0xFFFFFFFFu;
+    const uint32_t MAX_ATOMS = NO_ATOM - (1u << FIRST_CHUNK_BITS) + 1; ///< fit in the chunks
+    const size_t BLOCK = 64 * 1024;
+
+    class Table {
+            struct Slot {
+                uint32_t id;   ///< or NO_ATOM
+                uint32_t hash; ///< low bits, which give the slot
+            };
+
+            struct Shard {
+                std::mutex mutex;
+                std::vector<Slot> slots; ///< open addressing, linear probing
+                size_t count;
+                std::vector<std::unique_ptr<char[]>> blocks;
+                char* next; ///< free space in the last block
+                size_t left;
+            };
+
+            Shard shards[1 << SHARD_BITS];
+            std::atomic<uint32_t> next;
+            std::atomic<const char**> chunks[CHUNKS];
+
+            static void locate(uint32_t id, size_t& chunk, size_t& offset) {
+                uint64_t i = uint64_t(id) + (1u << FIRST_CHUNK_BITS);
+                chunk = 63 - __builtin_clzll(i) - FIRST_CHUNK_BITS;
+                offset = size_t(i - (uint64_t(1) << (chunk + FIRST_CHUNK_BITS)));
+            }
+
+            /// Copies the string into the blocks of \a shard
+            static const char* copy(Shard& shard, const char* s, uint32_t n) {
+                size_t size = (sizeof(uint32_t) + n + alignof(uint32_t) - 1) & ~(alignof(uint32_t) - 1);
+                if (size > shard.left) {
+                    size_t block = std::max(BLOCK, size);
+                    shard.blocks.emplace_back(new char[block]);
+                    shard.next = shard.blocks.back().get();
+                    shard.left = block;
+                }
+                char* copy = shard.next;
+                std::memcpy(copy, &n, sizeof(uint32_t));
+                std::memcpy(copy + sizeof(uint32_t), s, n);
+                shard.next += size;
+                shard.left -= size;
+                return copy;
+            }
+
+            const char*& entry(uint32_t id) {
+                size_t chunk, offset;
+                locate(id, chunk, offset);
+                const char** entries = chunks[chunk].load(std::memory_order_acquire);
+                if (entries == nullptr) { // another shard may be adding it too
+                    const char** fresh = new const char*[size_t(1) << (chunk + FIRST_CHUNK_BITS)];
+                    if (chunks[chunk].compare_exchange_strong(entries, fresh))
+                        entries = fresh;
+                    else
+                        delete[] fresh;
+                }
+                return entries[offset];
+            }
+
+            static void grow(Shard& shard) {
+                std::vector<Slot> slots(std::max<size_t>(shard.slots.size() * 2, 64),
+                                        Slot{NO_ATOM, 0});
+                size_t mask = slots.size() - 1;
+                for (const Slot& slot : shard.slots) {
+                    if (slot.id == NO_ATOM)
+                        continue;
+                    size_t i = slot.hash & mask;
+                    while (slots[i].id != NO_ATOM)
+                        i = (i + 1) & mask;
+                    slots[i] = slot;
+                }
+                shard.slots.swap(slots);
+            }
+
+        public:
+            Table() : next(0) {
+                for (Shard& shard : shards) {
+                    shard.count = 0;
+                    shard.next = nullptr;
+                    shard.left = 0;
+                }
+                for (auto& chunk : chunks)
+                    chunk.store(nullptr);
+                intern("", 0, hash_words("", 0)); // id 0
+            }
+
+            ~Table() {
+                for (auto& chunk : chunks)
+                    delete[] chunk.load();
+            }
+
+            void clear() {
+                for (Shard& shard : shards) {
+                    std::lock_guard<std::mutex> lock(shard.mutex);
+                    std::vector<Slot>().swap(shard.slots);
+                    std::vector<std::unique_ptr<char[]>>().swap(shard.blocks);
+                    shard.count = 0;
+                    shard.next = nullptr;
+                    shard.left = 0;
+                }
+                for (auto& chunk : chunks)
+                    delete[] chunk.exchange(nullptr);
+                next.store(0);
+                intern("", 0, hash_words("", 0)); // id 0
+            }
+
+            uint32_t intern(const char* s, size_t n, uint64_t hash) {
+                if (n > NO_ATOM)
+                    throw std::length_error("too long string for Atom");
+                Shard& shard = shards[hash >> (64 - SHARD_BITS)];
+                uint32_t low = uint32_t(hash);
+                std::lock_guard<std::mutex> lock(shard.mutex);
+                if ((shard.count + 1) * 4 > shard.slots.size() * 3)
+                    grow(shard);
+                size_t mask = shard.slots.size() - 1;
+                for (size_t i = low & mask; ; i = (i + 1) & mask) {
+                    Slot& slot = shard.slots[i];
+                    if (slot.id == NO_ATOM) {
+                        uint32_t id = next.fetch_add(1);
+                        if (id >= MAX_ATOMS)
+                            throw std::length_error("too many atoms");
+                        entry(id) = copy(shard, s, uint32_t(n));
+                        slot = Slot{id, low};
+                        ++shard.count;
+                        return id;
+                    }
+                    if (slot.hash == low) {
+                        StringRef str = this -> str(slot.id);
+                        if (str.length() == n && std::memcmp(str.data(), s, n) == 0)
+                            return slot.id;
+                    }
+                }
+            }
+
+            StringRef str(uint32_t id) const {
+                size_t chunk, offset;
+                locate(id, chunk, offset);
+                const char* copy = chunks[chunk].load(std::memory_order_acquire)[offset];
+                uint32_t n;
+                std::memcpy(&n, copy, sizeof(uint32_t));
+                return StringRef(copy + sizeof(uint32_t), n);
+            }
+
+            size_t size() const {
+                return next.load();
+            }
+    };
+
+    Table& table() {
+        static Table atoms;
+        return atoms;
+    }
+}
+
+Atom::Atom(StringRef str) : id_(table().intern(str.data(), str.length(),
+                                               hash_words(str.data(), str.length()))) {}
+
+Atom Atom::lower_case(StringRef str) {
+    const size_t SHORT = 64;
+    char buffer[SHORT];
+    std::string long_buffer;
+    size_t n = str.length();
+    char* folded = buffer;
+    if (n > SHORT) {
+        long_buffer.resize(n);
+        folded = &long_buffer[0];
+    }
+    size_t i = 0;
+    for ( ; i + 8 <= n; i += 8) {
+        uint64_t word = fold_word(load_word(str.data() + i, 8));
+        std::memcpy(folded + i, &word, 8);
+    }
+    if (i < n) {
+        uint64_t word = fold_word(load_word(str.data() + i, n - i));
+        std::memcpy(folded + i, &word, n - i);
+    }
+    return Atom(table().intern(folded, n, hash_words(folded, n)));
+}
+
+Atom Atom::from_id(uint32_t id) {
+    return Atom(id);
+}
+
+StringRef Atom::str() const {
+    return table().str(id_);
+}
+
+size_t Atom::count() {
+    return table().size();
+}
+
+void Atom::clear() {
+    table().clear();
+}
+
+std::ostream& operator<<(std::ostream& out, Atom atom) {
+    return out << atom.str();
+}
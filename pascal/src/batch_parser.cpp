@@ -0,0 +1,118 @@
+#include "batch_parser.h"
+
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <exception>
+#include <thread>
+
+#include <sys/stat.h>
+
+namespace {
+    /// Indices of sources waiting for a worker
+    struct WorkQueue {
+        std::mutex lock;
+        std::deque<size_t> jobs; ///< the largest source first
+
+        /// The owner takes the largest source
+        bool pop(size_t& job) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (jobs.empty())
+                return false;
+            job = jobs.front();
+            jobs.pop_front();
+            return true;
+        }
+
+        /// Other workers take the smallest one, leaving large ones to the owner
+        bool steal(size_t& job) {
+            std::lock_guard<std::mutex> guard(lock);
+            if (jobs.empty())
+                return false;
+            job = jobs.back();
+            jobs.pop_back();
+            return true;
+        }
+    };
+}
+
+BatchParser::BatchParser(unsigned threads) : threads(threads) {
+    if (this -> threads == 0)
+        this -> threads = std::max(1u, std::thread::hardware_concurrency());
+}
+
+void BatchParser::add_file(const std::string& path) {
+    struct stat st;
+    size_t size = stat(path.c_str(), &st) == 0 ? st.st_size : 0; // for scheduling only
+    sources.push_back(Source{path, StringRef(), true, size});
+}
+
+void BatchParser::add_buffer(const std::string& name, StringRef text) {
+    sources.push_back(Source{name, text, false, text.size()});
+}
+
+size_t BatchParser::size() const {
+    return sources.size();
+}
+
+void BatchParser::parse_one(const Source& source, BatchResult& result) const {
+    auto start = std::chrono::steady_clock::now();
+    result.name = source.name;
+    try {
+        StringRef text = source.text;
+        std::unique_ptr<MappedFile> file; // unmapped once parsed
+        if (source.is_file) {
+            file.reset(new MappedFile(source.name));
+            text = file -> text();
+        }
+        result.bytes = text.size();
+        result.ast = PascalGrammar::parse(text, &result.tokens);
+    } catch (std::exception& e) {
+        /* anything escaping a worker thread would terminate the batch,
+           e.g. std::length_error from an overflowing table or bad_alloc */
+        result.ast.reset();
+        result.error = e.what();
+    }
+    result.seconds = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+}
+
+std::vector<BatchResult> BatchParser::run() const {
+    std::vector<BatchResult> results(sources.size());
+    if (sources.empty())
+        return results;
+
+    std::vector<size_t> order(sources.size());
+    for (size_t i = 0; i < order.size(); ++i)
+        order[i] = i;
+    std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+        return sources[a].size > sources[b].size;
+    });
+
+    // dealt like cards, so every queue starts with one of the largest sources
+    size_t workers = std::min<size_t>(threads, sources.size());
+    std::vector<WorkQueue> queues(workers);
+    for (size_t i = 0; i < order.size(); ++i)
+        queues[i % workers].jobs.push_back(order[i]);
+
+    auto work = [&](size_t self) {
+        size_t job;
+        while (true) {
+            bool found = queues[self].pop(job);
+            for (size_t k = 1; !found && k < workers; ++k)
+                found = queues[(self + k) % workers].steal(job);
+            if (!found)
+                return; // nothing is added while running, so all work is taken
+            parse_one(sources[job], results[job]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (size_t i = 1; i < workers; ++i)
+        pool.push_back(std::thread(work, i));
+    work(0);
+    for (auto& t : pool)
+        t.join();
+    return results;
+}
@@ -0,0 +1,314 @@
+#include "flat_ast.h"
+#include "node.h"
+#include "visitor.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+const NodeId FlatAst::NO_NODE;
+
+/* Visits nodes taken from a stack instead of recursing: visiting a node
+   pushes its children, in order, onto the stack after a mark which
+   closes the subtree of the node once they all are popped */
+struct FlatAst::Builder : public Visitor<std::add_const> {
+    FlatAst& ast;
+    struct Item {
+        PNode node;   ///< null for the mark
+        NodeId index; ///< node whose subtree the mark closes
+    };
+    std::vector<Item> stack;
+    NodeId current; ///< node being visited
+
+    Builder(FlatAst& ast) : ast(ast), current(NO_NODE) {
+        Visits<Builder, EmptyNode, ErrorNode, UIntegerNumberNode, URealNumberNode,
+               IntegerNumberNode, RealNumberNode, IdentifierNode, StringNode,
+               ConstantNode, OperationNode, SignNode, SubrangeNode, SubrangeTypeNode,
+               EnumeratedTypeNode, VariableDeclNode, RecordTypeNode, SetTypeNode,
+               FileTypeNode, PointerTypeNode, IndexTypeNode, ArrayTypeNode,
+               VariableSectionNode, TypeDefinitionNode, PackedTypeNode, DeclarationNode,
+               ExpressionNode, SetExpressionNode, SetNode, IndexedVariableNode,
+               ReferencedVariableNode, FieldDesignatorNode, FunctionDesignatorNode,
+               AssignmentStatementNode, StatementNode, CompoundStatementNode,
+               WhileStatementNode, RepeatStatementNode, ForStatementNode, IfThenNode,
+               IfThenElseNode, VariableNode, WithStatementNode, CaseLimbNode,
+               CaseStatementNode, ConstDefinitionNode, BoundSpecificationNode,
+               UCArraySchemaNode, PCArraySchemaNode, VariableParameterNode,
+               ValueParameterNode, ProcedureHeadingNode, ParameterNode,
+               FunctionHeadingNode, FunctionIdentificationNode, ProcedureNode,
+               FunctionNode, ProcedureForwardDeclNode, FunctionForwardDeclNode,
+#ifdef PASCAL_6000
+               ProcedureExternDeclNode, FunctionExternDeclNode,
+#endif
+               BlockNode, OutputValueNode, WriteNode, WriteLineNode, RecordSectionNode,
+               FieldVariantNode, FieldListNode, LabeledStatementNode, LabelSectionNode,
+               GotoStatementNode, ProgramHeadingNode, ProgramNode,
+               IntegerNumberListNode, IdentifierListNode, ConstantListNode,
+               VariableDeclListNode, IndexTypeListNode, TypeSectionNode,
+               DeclarationListNode, ExpressionListNode, SetExpressionListNode,
+               StatementListNode, VariableListNode, CaseLimbListNode, ConstSectionNode,
+               BoundSpecificationListNode, ParameterListNode, OutputValueListNode,
+               FixedPartNode, VariantPartNode, ListOf<Node>, Node>();
+    }
+
+    void build(const PNode& root) {
+        stack.push_back(Item{root, NO_NODE});
+        while (!stack.empty()) {
+            Item item = std::move(stack.back());
+            stack.pop_back();
+            if (!item.node) {
+                ast.ends_[item.index] = NodeId(ast.tags_.size());
+                continue;
+            }
+            if (ast.tags_.size() >= NO_NODE)
+                throw std::length_error("too many nodes for FlatAst");
+            current = NodeId(ast.tags_.size());
+            ast.tags_.push_back(uint16_t(item.node -> tag()));
+            ast.ends_.push_back(NO_NODE);
+            ast.payloads_.push_back(0);
+
+            stack.push_back(Item{PNode(), current});
+            size_t mark = stack.size();
+            travel(item.node);
+            std::reverse(stack.begin() + mark, stack.end());
+        }
+    }
+
+    void child(const PNode& node) {
+        if (node)
+            stack.push_back(Item{node, NO_NODE});
+    }
+
+    void payload(uint32_t value) {
+        ast.payloads_[current] = value;
+    }
+
+    void atom(Atom name) {
+        payload(name.id());
+    }
+
+    void name(const std::string& name) {
+        payload(uint32_t(ast.names_.size()));
+        ast.names_.push_back(name);
+    }
+
+    void number(const Number& number) {
+        payload(uint32_t(ast.numbers_.size()));
+        ast.numbers_.push_back(number);
+    }
+
+    /* nodes without children and values, such as EmptyNode */
+    void visit(const std::shared_ptr<Node>&) {}
+
+    template <typename T>
+    void visit(const std::shared_ptr<ListOf<T>>& e) {
+        for (auto it = e -> list().begin(); it != e -> list().end(); ++it)
+            child(*it);
+    }
+
+    void visit(const std::shared_ptr<ErrorNode>& e) { name(e -> message); }
+    void visit(const std::shared_ptr<UIntegerNumberNode>& e) {
+        number(Number{e -> value, 0, e -> position, e -> length});
+    }
+    void visit(const std::shared_ptr<URealNumberNode>& e) {
+        number(Number{0, e -> value, e -> position, e -> length});
+    }
+    void visit(const std::shared_ptr<IntegerNumberNode>& e) { payload(e -> sign); child(e -> value); }
+    void visit(const std::shared_ptr<RealNumberNode>& e) { payload(e -> sign); child(e -> value); }
+    void visit(const std::shared_ptr<IdentifierNode>& e) { atom(e -> name); }
+    void visit(const std::shared_ptr<StringNode>& e) { name(e -> str); }
+    void visit(const std::shared_ptr<ConstantNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<OperationNode>& e) {
+        payload(uint32_t(e -> op()));
+        for (auto it = e -> args.begin(); it != e -> args.end(); ++it)
+            child(*it);
+    }
+    void visit(const std::shared_ptr<SignNode>& e) { payload(e -> sign()); child(e -> child); }
+    void visit(const std::shared_ptr<SubrangeNode>& e) {
+        child(e -> lower_bound); child(e -> upper_bound);
+    }
+    void visit(const std::shared_ptr<SubrangeTypeNode>& e) {
+        child(e -> lower_bound); child(e -> upper_bound);
+    }
+    void visit(const std::shared_ptr<EnumeratedTypeNode>& e) { child(e -> identifiers); }
+    void visit(const std::shared_ptr<VariableDeclNode>& e) { child(e -> id_list); child(e -> type); }
+    void visit(const std::shared_ptr<RecordTypeNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<SetTypeNode>& e) { child(e -> type); }
+    void visit(const std::shared_ptr<FileTypeNode>& e) { child(e -> type); }
+    void visit(const std::shared_ptr<PointerTypeNode>& e) { child(e -> type); }
+    void visit(const std::shared_ptr<IndexTypeNode>& e) { child(e -> type); }
+    void visit(const std::shared_ptr<ArrayTypeNode>& e) {
+        child(e -> index_type_list); child(e -> type);
+    }
+    void visit(const std::shared_ptr<VariableSectionNode>& e) { child(e -> declarations); }
+    void visit(const std::shared_ptr<TypeDefinitionNode>& e) { child(e -> name); child(e -> type); }
+    void visit(const std::shared_ptr<PackedTypeNode>& e) { child(e -> type); }
+    void visit(const std::shared_ptr<DeclarationNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<ExpressionNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<SetExpressionNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<SetNode>& e) { child(e -> elements); }
+    void visit(const std::shared_ptr<IndexedVariableNode>& e) {
+        child(e -> array_variable); child(e -> indices);
+    }
+    void visit(const std::shared_ptr<ReferencedVariableNode>& e) { child(e -> variable); }
+    void visit(const std::shared_ptr<FieldDesignatorNode>& e) {
+        child(e -> variable); child(e -> field);
+    }
+    void visit(const std::shared_ptr<FunctionDesignatorNode>& e) {
+        child(e -> function); child(e -> parameters);
+    }
+    void visit(const std::shared_ptr<AssignmentStatementNode>& e) {
+        child(e -> variable); child(e -> expression);
+    }
+    void visit(const std::shared_ptr<StatementNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<CompoundStatementNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<WhileStatementNode>& e) {
+        child(e -> condition); child(e -> body);
+    }
+    void visit(const std::shared_ptr<RepeatStatementNode>& e) {
+        child(e -> body); child(e -> condition);
+    }
+    void visit(const std::shared_ptr<ForStatementNode>& e) {
+        payload(uint32_t(e -> direction));
+        child(e -> variable); child(e -> initial_expression);
+        child(e -> final_expression); child(e -> body);
+    }
+    void visit(const std::shared_ptr<IfThenNode>& e) { child(e -> condition); child(e -> body); }
+    void visit(const std::shared_ptr<IfThenElseNode>& e) {
+        child(e -> condition); child(e -> then_body); child(e -> else_body);
+    }
+    void visit(const std::shared_ptr<VariableNode>& e) { child(e -> variable); }
+    void visit(const std::shared_ptr<WithStatementNode>& e) {
+        child(e -> record_variables); child(e -> body);
+    }
+    void visit(const std::shared_ptr<CaseLimbNode>& e) { child(e -> constants); child(e -> body); }
+    void visit(const std::shared_ptr<CaseStatementNode>& e) {
+        child(e -> expression); child(e -> limbs);
+    }
+    void visit(const std::shared_ptr<ConstDefinitionNode>& e) {
+        child(e -> identifier); child(e -> constant);
+    }
+    void visit(const std::shared_ptr<BoundSpecificationNode>& e) {
+        child(e -> lower_bound); child(e -> upper_bound); child(e -> type);
+    }
+    void visit(const std::shared_ptr<UCArraySchemaNode>& e) { child(e -> bounds); child(e -> type); }
+    void visit(const std::shared_ptr<PCArraySchemaNode>& e) { child(e -> bounds); child(e -> type); }
+    void visit(const std::shared_ptr<VariableParameterNode>& e) {
+        child(e -> identifiers); child(e -> type);
+    }
+    void visit(const std::shared_ptr<ValueParameterNode>& e) {
+        child(e -> identifiers); child(e -> type);
+    }
+    void visit(const std::shared_ptr<ProcedureHeadingNode>& e) { atom(e -> name); child(e -> params); }
+    void visit(const std::shared_ptr<ParameterNode>& e) { child(e -> child); }
+    void visit(const std::shared_ptr<FunctionHeadingNode>& e) {
+        atom(e -> name); child(e -> params); child(e -> return_type);
+    }
+    void visit(const std::shared_ptr<FunctionIdentificationNode>& e) { atom(e -> name); }
+    void visit(const std::shared_ptr<ProcedureNode>& e) { child(e -> heading); child(e -> body); }
+    void visit(const std::shared_ptr<FunctionNode>& e) { child(e -> heading); child(e -> body); }
+    void visit(const std::shared_ptr<ProcedureForwardDeclNode>& e) { child(e -> heading); }
+    void visit(const std::shared_ptr<FunctionForwardDeclNode>& e) { child(e -> heading); }
+#ifdef PASCAL_6000
+    void visit(const std::shared_ptr<ProcedureExternDeclNode>& e) { child(e -> heading); }
+    void visit(const std::shared_ptr<FunctionExternDeclNode>& e) { child(e -> heading); }
+#endif
+    void visit(const std::shared_ptr<BlockNode>& e) {
+        child(e -> declarations); child(e -> statements);
+    }
+    void visit(const std::shared_ptr<OutputValueNode>& e) {
+        child(e -> expression); child(e -> field_width); child(e -> fraction_length);
+    }
+    void visit(const std::shared_ptr<WriteNode>& e) { child(e -> output_list); }
+    void visit(const std::shared_ptr<WriteLineNode>& e) { child(e -> output_list); }
+    void visit(const std::shared_ptr<RecordSectionNode>& e) { child(e -> id_list); child(e -> type); }
+    void visit(const std::shared_ptr<FieldVariantNode>& e) {
+        child(e -> case_labels); child(e -> fields);
+    }
+    void visit(const std::shared_ptr<FieldListNode>& e) {
+        child(e -> fixed_part); child(e -> variant_part);
+    }
+    void visit(const std::shared_ptr<LabeledStatementNode>& e) {
+        child(e -> label); child(e -> statement);
+    }
+    void visit(const std::shared_ptr<LabelSectionNode>& e) { child(e -> list); }
+    void visit(const std::shared_ptr<GotoStatementNode>& e) { child(e -> label); }
+    void visit(const std::shared_ptr<ProgramHeadingNode>& e) { atom(e -> name); child(e -> files); }
+    void visit(const std::shared_ptr<ProgramNode>& e) { child(e -> heading); child(e -> block); }
+};
+
+FlatAst::FlatAst(const PNode& root) {
+    Builder builder(*this);
+    builder.build(root);
+}
+
+size_t FlatAst::size() const {
+    return tags_.size();
+}
+
+const std::vector<uint16_t>& FlatAst::tags() const {
+    return tags_;
+}
+
+size_t FlatAst::tag(NodeId i) const {
+    return tags_[i];
+}
+
+NodeId FlatAst::end(NodeId i) const {
+    return ends_[i];
+}
+
+NodeId FlatAst::first_child(NodeId i) const {
+    return ends_[i] > i + 1 ? i + 1 : NO_NODE;
+}
+
+NodeId FlatAst::next_sibling(NodeId i, NodeId parent_end) const {
+    return ends_[i] < parent_end ? ends_[i] : NO_NODE;
+}
+
+size_t FlatAst::arity(NodeId i) const {
+    size_t count = 0;
+    for (NodeId child = i + 1; child < ends_[i]; child = ends_[child])
+        ++count;
+    return count;
+}
+
+FlatAst::Children::Children(const FlatAst* ast, NodeId parent) :
+    ast(ast), first(parent + 1), last(ast -> ends_[parent]) {}
+
+FlatAst::Children FlatAst::children(NodeId i) const {
+    return Children(this, i);
+}
+
+uint32_t FlatAst::payload(NodeId i) const {
+    return payloads_[i];
+}
+
+Atom FlatAst::atom(NodeId i) const {
+    return Atom::from_id(payloads_[i]);
+}
+
+const std::string& FlatAst::name(NodeId i) const {
+    return names_[payloads_[i]];
+}
+
+uint64_t FlatAst::integer(NodeId i) const {
+    return numbers_[payloads_[i]].integer;
+}
+
+double FlatAst::real(NodeId i) const {
+    return numbers_[payloads_[i]].real;
+}
+
+size_t FlatAst::position(NodeId i) const {
+    return numbers_[payloads_[i]].position;
+}
+
+size_t FlatAst::length(NodeId i) const {
+    return numbers_[payloads_[i]].length;
+}
+
+size_t FlatAst::bytes() const {
+    return tags_.size() * sizeof(uint16_t) + ends_.size() * sizeof(NodeId) +
+           payloads_.size() * sizeof(uint32_t) + names_.size() * sizeof(std::string) +
+           numbers_.size() * sizeof(Number);
+}
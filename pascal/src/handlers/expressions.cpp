@@ -2,16 +2,19 @@
 
 //#include "pascal_grammar.h"
 //#include "node_traits.h"
-#include "list_guard.h"
+#include "list_mode.h"
 
 namespace pascal_grammar {
     namespace detail {
         template <typename ExprType>
         struct ExpressionListParser {
+            const Mode<PNode>& mode; ///< where ',' separates expressions of ExprType
+
+            ExpressionListParser(const Mode<PNode>& mode) : mode(mode) {}
+
             PNode operator()(PascalGrammar& g) {
-                PrattParser<PNode>& p = *(g.parser);
-                PascalGrammar::lbp_guard comma_lbp_guard(*(g.comma), 1);
-                PascalGrammar::list_guard<ExprType> comma_guard(g, g.comma, "expression");
+                PrattParser<PNode>& p = g.parser();
+                PascalGrammar::mode_guard guard(p, mode);
 
                 PNode elements = p.parse(0); /* must be less than lbp of subexpressions */
 
@@ -28,25 +31,34 @@ namespace pascal_grammar {
         typedef PascalGrammar::RightAssociative RightAssociative;
 
         
-       g.add_symbol_to_dict("]", 0);
-       g.add_symbol_to_dict("[", 1000) 
-        .nud = [&g](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::behaviour_guard<PascalGrammar::LeftAssociative> range_guard(*(g.range),
-                [&g](PNode left, PNode right) -> PNode {
-                    if (!node_traits::is_convertible_to<ExpressionNode>(left))
-                        g.error("expected expression as subrange lower bound");
-                    if (!node_traits::is_convertible_to<ExpressionNode>(right))
-                        g.error("expected expression as subrange upper bound");
-                    return std::make_shared<SubrangeNode>(left, right);
-                });
-            if (p.next_token_as_string() == "]") {
+       g.modes.expression_list.set_lbp(*(g.comma), 1);
+       g.set_list<ExpressionNode>(g.modes.expression_list, g.comma, "expression");
+
+       g.modes.set_expression_list.set_lbp(*(g.comma), 1);
+       g.set_list<SetExpressionNode>(g.modes.set_expression_list, g.comma, "expression");
+
+       g.set_behaviour<PascalGrammar::LeftAssociative>(g.modes.set_constructor, *(g.range),
+            [&g](PNode left, PNode right) -> PNode {
+                if (!node_traits::is_convertible_to<ExpressionNode>(left))
+                    g.error("expected expression as subrange lower bound");
+                if (!node_traits::is_convertible_to<ExpressionNode>(right))
+                    g.error("expected expression as subrange upper bound");
+                return make_node<SubrangeNode>(left, right);
+            });
+
+       g.closing_square_bracket = &g.add_symbol_to_dict("]", 0);
+       g.opening_square_bracket = &g.add_symbol_to_dict("[", 1000);
+       g.opening_square_bracket -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+            PascalGrammar::mode_guard guard(p, g.modes.set_constructor);
+            if (p.next_is(*(g.closing_square_bracket))) {
                 p.advance();
-                return std::make_shared<SetNode>(
-                        std::make_shared<ExpressionListNode>());
+                return make_node<SetNode>(
+                        make_node<ExpressionListNode>());
             }
-            static detail::ExpressionListParser<SetExpressionNode> parse_set_expressions;
-            PNode set = std::make_shared<SetNode>(parse_set_expressions(g));
-            g.advance("]", "expected ']' after list of expressions/subranges");
+            static detail::ExpressionListParser<SetExpressionNode> 
+                parse_set_expressions(g.modes.set_expression_list);
+            PNode set = make_node<SetNode>(parse_set_expressions(g));
+            g.advance(*(g.closing_square_bracket), "expected ']' after list of expressions/subranges");
             return set;
         };
 
@@ -55,16 +67,17 @@ namespace pascal_grammar {
         (PrattParser<PNode>& p, PNode left) -> PNode {
             if (!node_traits::is_convertible_to<VariableNode>(left))
                 g.error("expected a variable before '['");
-            static detail::ExpressionListParser<ExpressionNode> parse_indices;
-            PNode indices =  std::make_shared<IndexedVariableNode>(left, parse_indices(g));
-            g.advance("]", "expected ']' after list of indices");
+            static detail::ExpressionListParser<ExpressionNode> 
+                parse_indices(g.modes.expression_list);
+            PNode indices =  make_node<IndexedVariableNode>(left, parse_indices(g));
+            g.advance(*(g.closing_square_bracket), "expected ']' after list of indices");
             return indices;
         };
 
        g.postfix("^", 1000, [&g](PNode node) -> PNode {
                 if (!node_traits::is_convertible_to<VariableNode>(node)) 
                     g.error("expected a variable before '^'");
-                return std::make_shared<ReferencedVariableNode>(node);
+                return make_node<ReferencedVariableNode>(node);
             });
 
        g.dot = &g.infix(".", 1000, [&g](PNode var, PNode field) -> PNode {
@@ -72,7 +85,7 @@ namespace pascal_grammar {
                 g.error("expected a variable before '.'");
             if (!node_traits::has_type<IdentifierNode>(field)) 
                 g.error("expected identifier after '.'");
-                return std::make_shared<FieldDesignatorNode>(var, field);
+                return make_node<FieldDesignatorNode>(var, field);
             });
        g.dot -> lbp = 0; // 0 is changed to 1000 in 'begin' handler
 
@@ -81,10 +94,11 @@ namespace pascal_grammar {
         .led = [&g](PrattParser<PNode>& p, PNode left) -> PNode {
                 if (!node_traits::has_type<IdentifierNode>(left))
                     g.error("expected identifier before '(' token");
-                static detail::ExpressionListParser<ExpressionNode> parse_params;
+                static detail::ExpressionListParser<ExpressionNode> 
+                    parse_params(g.modes.expression_list);
                 PNode params = parse_params(g);
-                g.advance(")", "expected ')' token after the list of parameters");
-                return std::make_shared<FunctionDesignatorNode>(left, params);
+                g.advance(*(g.closing_bracket), "expected ')' token after the list of parameters");
+                return make_node<FunctionDesignatorNode>(left, params);
             };
     }
 }
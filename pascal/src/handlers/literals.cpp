@@ -10,33 +10,30 @@ namespace pascal_grammar {
     void add_literals(PascalGrammar& g) {
 
        g.add_symbol_to_dict("(number)", 0)
-        .set_scanner(pascal::number_scanner)
-        .set_parser([](const std::string& str, size_t beg, size_t end) -> PNode {
-            bool is_real = false;
-            for (size_t i = beg; i != str.length() && i < end; ++i) {
-                if (str[i] == '.') is_real = true;
-                if (str[i] == 'e') {
-                    return std::make_shared<URealNumberNode>(str.substr(0, i),
-                                                            str.substr(i + 1, end - i - 1));
-                }
-            }
-            if (is_real) {
-                return std::make_shared<URealNumberNode>(str.substr(beg, end - beg));
-            } else {
-                return std::make_shared<UIntegerNumberNode>(str.substr(beg, end - beg));
-            }
+        .set_scanner(pascal::number_scanner, pascal::number_first_chars)
+        .set_parser([](StringRef str, size_t beg, size_t end) -> PNode {
+            pascal::Number number = pascal::decode_number(str, beg, end);
+            if (number.error != nullptr) // reported by PascalGrammar::check_literals
+                return make_node<ErrorNode>(number.error);
+            if (number.is_real)
+                return make_node<URealNumberNode>(number.real, beg, end - beg);
+            return make_node<UIntegerNumberNode>(number.integer, beg, end - beg);
         });
 
        g.add_symbol_to_dict("(identifier)", 0)
-        .set_scanner(pascal::identifier_scanner)
-        .set_parser([](const std::string& str, size_t beg, size_t end) {
-            return std::make_shared<IdentifierNode>(str.substr(beg, end - beg));
-        });
+        .set_scanner(pascal::identifier_scanner, pascal::identifier_first_chars)
+        .set_parser([](StringRef str, size_t beg, size_t end) {
+            StringRef text = str.substr(beg, end - beg);
+            Atom name = Atom::lower_case(text);
+            // most names are spelled in lower case, that takes no second lookup
+            return make_node<IdentifierNode>(name, name.str() == text ? name : Atom(text));
+        })
+        .reserve_keywords();
 
        g.add_symbol_to_dict("(string literal)", 0)
-        .set_scanner(pascal::string_scanner)
-        .set_parser([](const std::string& str, size_t beg, size_t end) -> PNode {
-            return std::make_shared<StringNode>(pascal::string_parser(str, beg, end));
+        .set_scanner(pascal::string_scanner, pascal::string_first_chars)
+        .set_parser([](StringRef str, size_t beg, size_t end) -> PNode {
+            return make_node<StringNode>(pascal::string_parser(str, beg, end));
         });
 
     }
@@ -16,9 +16,9 @@ namespace pascal_grammar {
                 if (!node_traits::is_convertible_to<ExpressionNode>(x) ||
                     !node_traits::is_convertible_to<ExpressionNode>(y))
                     g.error("expected expression");
-                std::shared_ptr<OperationNode> expr = std::make_shared<OperationNode>(2, op);
-                expr -> args.push_front(y);
-                expr -> args.push_front(x);
+                std::shared_ptr<OperationNode> expr = make_node<OperationNode>(2, op);
+                expr -> args.push_back(x);
+                expr -> args.push_back(y);
                 return expr;
             };
         };
@@ -27,8 +27,8 @@ namespace pascal_grammar {
             return [&g, op](PNode x) -> std::shared_ptr<OperationNode> {
                 if (!node_traits::is_convertible_to<ExpressionNode>(x))
                     g.error("expected expression");
-                std::shared_ptr<OperationNode> expr = std::make_shared<OperationNode>(1, op);
-                expr -> args.push_front(x);
+                std::shared_ptr<OperationNode> expr = make_node<OperationNode>(1, op);
+                expr -> args.push_back(x);
                 return expr;
             };
         };
@@ -36,12 +36,12 @@ namespace pascal_grammar {
         auto createSignNud = [&g](char sign) -> std::function<PNode(PNode)> {
             return [&g, sign](PNode x) -> PNode {
                 if (node_traits::has_type<UIntegerNumberNode>(x))
-                    return std::make_shared<IntegerNumberNode>(x, sign);
+                    return make_node<IntegerNumberNode>(x, sign);
                 if (node_traits::has_type<URealNumberNode>(x))
-                    return std::make_shared<RealNumberNode>(x, sign);
+                    return make_node<RealNumberNode>(x, sign);
                 if (!node_traits::is_convertible_to<ExpressionNode>(x))
                     g.error(std::string("expected expression after ") + sign);
-                return std::make_shared<SignNode>(sign, x);
+                return make_node<SignNode>(sign, x);
             };
         };
                  /* negating operator */
@@ -68,18 +68,18 @@ namespace pascal_grammar {
         g.prefix("-", 150, createSignNud('-'), grammar::keep_symbol_lbp);
         /* </operators> */
 
-        g.add_symbol_to_dict(")", 0);
-
-        (g.opening_bracket = &g.add_symbol_to_dict("(", std::numeric_limits<int>::max()))
-        -> nud = [&g](PrattParser<PNode>& p) -> PNode {
-                PNode x = p.parse(0);
-                g.advance(")", "expected closing ')'");
+        g.closing_bracket = &g.add_symbol_to_dict(")", 0);
 
+        /* nested parentheses don't take native stack (see Combinator) */
+        g.opening_bracket = &g.brackets("(", std::numeric_limits<int>::max(),
+            [&g](PrattParser<PNode>&) {
+                g.advance(*(g.closing_bracket), "expected closing ')'");
+            },
+            [&g](PNode x) -> PNode {
                 if (!node_traits::is_convertible_to<ExpressionNode>(x)) 
                     g.error("expected expression after '('");
-
                 return x;
-        };
+            });
     }
 
 }
@@ -1,199 +1,191 @@
 //#include "pascal_grammar.h"
-#include "list_guard.h"
+#include "list_mode.h"
 
 namespace pascal_grammar {
     namespace detail {
-        struct bound_specification_guard {
-            PascalGrammar::lbp_guard colon_guard;
-            PascalGrammar::led_guard range_guard;
-            PascalGrammar::lbp_guard sl_guard;
-            PascalGrammar::behaviour_guard<PascalGrammar::RightAssociative> sb_guard;
-            bound_specification_guard(PascalGrammar& g) :
-                colon_guard(*(g.colon), 0),
-                range_guard(*(g.range),
-                [&g](PrattParser<PNode>& p, PNode left) -> PNode {
-                    if (!node_traits::has_type<IdentifierNode>(left))
-                        g.error("expected identifier before '..'");
-                    PNode right = p.parse(0);
-
-                    if (!node_traits::has_type<IdentifierNode>(right))
-                        g.error("expected identifier after '..'");
-                    g.advance(":", "expected ':' in bound specification");
-                    
-                    PNode type = p.parse(1); // semicolon ~ 1
-
-                    if (!node_traits::has_type<IdentifierNode>(type))
-                        g.error("expected ordinal type identifier after ':'");
-
-                    return std::make_shared<BoundSpecificationNode>(left, right, type);
-                }),
-                sl_guard(*(g.semicolon), 1),
-                sb_guard(*(g.semicolon), 
-                [&g](PNode left, PNode right) {
-                    return ListVisitor<BoundSpecificationNode>(left, right, &g,
-                                       "bound specification").get_expression();
-                }) {}
-        };
 
 PNode parse_formal_parameter_list(PrattParser<PNode>& p, PascalGrammar& g) {
+    PascalGrammar::mode_guard guard(p, g.modes.formal_parameters);
 
-    typedef PascalGrammar::RightAssociative RightAssociative;
-    typedef PascalGrammar::LeftAssociative LeftAssociative;
-    typedef PascalGrammar::Prefix Prefix;
+    PNode params = p.parse(0);
+    if (!node_traits::is_list_of<ParameterNode>(params))
+        g.error("expected list of formal parameters");
+    return params;
+}
 
-    PascalGrammar::nud_guard array_guard(*(g.array), 
-        [&g](PrattParser<PNode>& p) -> PNode {
-            g.advance("[", "expected '[' after 'array'");
-           
-            pascal_grammar::detail::bound_specification_guard bg(g);
+} // namespace detail
+} // namespace pascal_grammar
 
-            /// scan list of bound specifications
-            PNode bounds = p.parse(0); // semicolon led gets executed
-            if (!node_traits::is_list_of<BoundSpecificationNode>(bounds))
-                g.error("expected list of bound specifications after 'array ['");
+namespace pascal_grammar {
 
-            g.advance("]", "expected ']' in array parameter type declaration");
-            g.advance("of", "expected 'of' after ']'");
+    void add_procedures_and_functions(PascalGrammar& g) {
 
-            PNode type = p.parse(1); // parsing stops before semicolon
-            if (!node_traits::has_type<IdentifierNode>(type) &&
-                !node_traits::is_conformant_array_schema(type))
-                g.error("expected type identifier or conformant-array-schema after 'of'");
+        typedef PascalGrammar::LeftAssociative LeftAssociative;
 
-            return std::make_shared<UCArraySchemaNode>(bounds, type);
-        });
+        // --------------- bound specifications of conformant arrays -------------
 
-    PascalGrammar::nud_guard packed_guard(*(g.packed),
-        [&g](PrattParser<PNode>& p) -> PNode {
-            g.advance("array", "expected 'array' after 'packed'");
+        g.modes.bound_specification.set_lbp(*(g.colon), 0)
+                                   .set_led(*(g.range),
+            [&g](PrattParser<PNode>& p, PNode left) -> PNode {
+                if (!node_traits::has_type<IdentifierNode>(left))
+                    g.error("expected identifier before '..'");
+                PNode right = p.parse(0);
 
-            pascal_grammar::detail::bound_specification_guard bg(g);
+                if (!node_traits::has_type<IdentifierNode>(right))
+                    g.error("expected identifier after '..'");
+                g.advance(*(g.colon), "expected ':' in bound specification");
+                
+                PNode type = p.parse(1); // semicolon ~ 1
 
-            g.advance("[", "expected '[' after 'packed array'");
+                if (!node_traits::has_type<IdentifierNode>(type))
+                    g.error("expected ordinal type identifier after ':'");
 
-            PNode bounds = p.parse(0);
-            if (!node_traits::has_type<BoundSpecificationNode>(bounds))
-                g.error("expected bound specification after 'packed array ['");
+                return make_node<BoundSpecificationNode>(left, right, type);
+            })
+                                   .set_lbp(*(g.semicolon), 1);
+        g.set_list<BoundSpecificationNode>(g.modes.bound_specification, g.semicolon,
+                                           "bound specification");
 
-            g.advance("]", "expected ']' after bound specification");
-            g.advance("of", "expected 'of' after ']'");
-            
-            PNode id = p.parse(1); // see array_guard
+        // --------------- formal parameters -------------------------------------
 
-            if (!node_traits::has_type<IdentifierNode>(id))
-                g.error("expected type identifier after 'of'");
+        g.modes.formal_parameters.set_nud(*(g.array),
+            [&g](PrattParser<PNode>& p) -> PNode {
+                g.advance(*(g.opening_square_bracket), "expected '[' after 'array'");
+               
+                PascalGrammar::mode_guard guard(p, g.modes.bound_specification);
 
-            return std::make_shared<PCArraySchemaNode>(bounds, id);
-        });
+                /// scan list of bound specifications
+                PNode bounds = p.parse(0); // semicolon led gets executed
+                if (!node_traits::is_list_of<BoundSpecificationNode>(bounds))
+                    g.error("expected list of bound specifications after 'array ['");
 
-    PascalGrammar::nud_guard var_guard(*(g.var),
-        [&g](PrattParser<PNode>& p) -> PNode {
+                g.advance(*(g.closing_square_bracket), "expected ']' in array parameter type declaration");
+                g.advance(*(g.of), "expected 'of' after ']'");
 
-            /* comma ~ 80, semicolon ~ 1, colon ~ 70 */
-            PNode id_list = p.parse(70);
-            if (!node_traits::is_list_of<IdentifierNode>(id_list))
-                g.error("expected list of identifiers before ':'");
+                PNode type = p.parse(1); // parsing stops before semicolon
+                if (!node_traits::has_type<IdentifierNode>(type) &&
+                    !node_traits::is_conformant_array_schema(type))
+                    g.error("expected type identifier or conformant-array-schema after 'of'");
 
-            g.advance(":", "expected ':' after identifier list");
+                return make_node<UCArraySchemaNode>(bounds, type);
+            });
 
-            PNode param_type = p.parse(1); // stop before semicolon
-            if (!node_traits::is_parameter_type(param_type))
-                g.error("expected parameter type after ':'");
+        g.modes.formal_parameters.set_nud(*(g.packed),
+            [&g](PrattParser<PNode>& p) -> PNode {
+                g.advance(*(g.array), "expected 'array' after 'packed'");
 
-            return std::make_shared<VariableParameterNode>(id_list, param_type);
-        });
+                PascalGrammar::mode_guard guard(p, g.modes.bound_specification);
 
-    PascalGrammar::list_guard<ParameterNode> semicolon_guard(g, g.semicolon, 
-                                                    "formal parameter section");
+                g.advance(*(g.opening_square_bracket), "expected '[' after 'packed array'");
 
-    PascalGrammar::behaviour_guard<LeftAssociative> colon_guard(*(g.colon), 30,
-        [&g](PNode id_list, PNode param_type) -> PNode {
-            if (!node_traits::is_list_of<IdentifierNode>(id_list))
-                g.error("expected list of identifiers before ':'");
-            if (!node_traits::is_parameter_type(param_type))
-                g.error("expected parameter type after ':'");
+                PNode bounds = p.parse(0);
+                if (!node_traits::has_type<BoundSpecificationNode>(bounds))
+                    g.error("expected bound specification after 'packed array ['");
 
-            return std::make_shared<ValueParameterNode>(id_list, param_type);
-        });
+                g.advance(*(g.closing_square_bracket), "expected ']' after bound specification");
+                g.advance(*(g.of), "expected 'of' after ']'");
+                
+                PNode id = p.parse(1); // see 'array' above
 
-    // --------------- scan parameters -------------------------------------- 
-    
-    PNode params = p.parse(0);
-    if (!node_traits::is_list_of<ParameterNode>(params))
-        g.error("expected list of formal parameters");
-    return params;
-}
+                if (!node_traits::has_type<IdentifierNode>(id))
+                    g.error("expected type identifier after 'of'");
 
-} // namespace detail
-} // namespace pascal_grammar
+                return make_node<PCArraySchemaNode>(bounds, id);
+            });
 
-namespace pascal_grammar {
+        g.modes.formal_parameters.set_nud(*(g.var),
+            [&g](PrattParser<PNode>& p) -> PNode {
 
-    void add_procedures_and_functions(PascalGrammar& g) {
+                /* comma ~ 80, semicolon ~ 1, colon ~ 70 */
+                PNode id_list = p.parse(70);
+                if (!node_traits::is_list_of<IdentifierNode>(id_list))
+                    g.error("expected list of identifiers before ':'");
+
+                g.advance(*(g.colon), "expected ':' after identifier list");
+
+                PNode param_type = p.parse(1); // stop before semicolon
+                if (!node_traits::is_parameter_type(param_type))
+                    g.error("expected parameter type after ':'");
+
+                return make_node<VariableParameterNode>(id_list, param_type);
+            });
+
+        g.set_list<ParameterNode>(g.modes.formal_parameters, g.semicolon, 
+                                  "formal parameter section");
+
+        g.set_behaviour<LeftAssociative>(g.modes.formal_parameters, *(g.colon), 30,
+            [&g](PNode id_list, PNode param_type) -> PNode {
+                if (!node_traits::is_list_of<IdentifierNode>(id_list))
+                    g.error("expected list of identifiers before ':'");
+                if (!node_traits::is_parameter_type(param_type))
+                    g.error("expected parameter type after ':'");
+
+                return make_node<ValueParameterNode>(id_list, param_type);
+            });
+
+        // --------------- headings ----------------------------------------------
+
+        g.modes.procedure_heading.set_lbp(*(g.opening_bracket), 0)
+                                 .set_lbp(*(g.semicolon), 1);
+        g.set_list<IdentifierNode>(g.modes.procedure_heading, g.comma, "identifier");
+
+        g.modes.function_heading.set_lbp(*(g.opening_bracket), 0)
+                                .set_lbp(*(g.semicolon), 1)
+                                .set_lbp(*(g.colon), 1);
+        g.set_list<IdentifierNode>(g.modes.function_heading, g.comma, "identifier");
 
-        g.add_symbol_to_dict("procedure", 1)
-         .nud = [&g](PrattParser<PNode>& p) -> PNode {
-              PascalGrammar::lbp_guard ob_guard(*(g.opening_bracket), 0);
-              PascalGrammar::lbp_guard semicolon_lbp_guard(*(g.semicolon), 1);
-              PascalGrammar::list_guard<IdentifierNode> comma_guard(g, g.comma, "identifier");
+        g.procedure = &g.add_symbol_to_dict("procedure", 1);
+        g.procedure -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+              PascalGrammar::mode_guard guard(p, g.modes.procedure_heading);
 
               PNode name_ = p.parse(1);
-              std::string name;
+              Atom name;
               if (!node_traits::has_type<IdentifierNode>(name_)) {
                   g.error("expected procedure name");
               } else {
                   name = std::static_pointer_cast<IdentifierNode>(name_) -> name;
               }
-              auto next = p.next_token_as_string();
-              if (next != "(") {
-                  return std::make_shared<ProcedureHeadingNode>(name,
-                          std::make_shared<ParameterListNode>());
+              if (!p.next_is(*(g.opening_bracket))) {
+                  return make_node<ProcedureHeadingNode>(name,
+                          make_node<ParameterListNode>());
               } else {
                   p.advance();
                   PNode params = pascal_grammar::detail::parse_formal_parameter_list(p, g);
-                  g.advance(")", "expected ')' after formal parameter list");
-                  return std::make_shared<ProcedureHeadingNode>(name, params);
+                  g.advance(*(g.closing_bracket), "expected ')' after formal parameter list");
+                  return make_node<ProcedureHeadingNode>(name, params);
               }
          };
 
-        g.add_symbol_to_dict("function", 1)
-         .nud = [&g](PrattParser<PNode>& p) -> PNode {
-              PascalGrammar::lbp_guard ob_guard(*(g.opening_bracket), 0);
-              PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 1);
-              PascalGrammar::lbp_guard colon_guard(*(g.colon), 1);
-              PascalGrammar::behaviour_guard<PascalGrammar::RightAssociative> comma_guard(*(g.comma),
-                [&g](PNode left, PNode right) {
-                    return ListVisitor<IdentifierNode>(left, right, &g, "identifier")
-                           .get_expression();
-                });
+        g.function = &g.add_symbol_to_dict("function", 1);
+        g.function -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+              PascalGrammar::mode_guard guard(p, g.modes.function_heading);
 
               PNode name_ = p.parse(1);
-              std::string name;
+              Atom name;
               if (!node_traits::has_type<IdentifierNode>(name_)) {
                   g.error("expected function name");
               } else {
                   name = std::static_pointer_cast<IdentifierNode>(name_) -> name;
               }
 
-              PNode params = std::make_shared<ParameterListNode>();
-              auto next = p.next_token_as_string();
-              if (next == ";") { // Function identification node
-                  return std::make_shared<FunctionIdentificationNode>(name);
-              } else if (next != "(") {
-                  g.advance(":", "expected ':' in function heading");
+              PNode params = make_node<ParameterListNode>();
+              if (p.next_is(*(g.semicolon))) { // Function identification node
+                  return make_node<FunctionIdentificationNode>(name);
+              } else if (!p.next_is(*(g.opening_bracket))) {
+                  g.advance(*(g.colon), "expected ':' in function heading");
               } else {
                   p.advance();
                   params = pascal_grammar::detail::parse_formal_parameter_list(p, g);
 
-                  g.advance(")", "expected ')' after formal parameter list");
-                  g.advance(":", "expected ':' in function heading");
+                  g.advance(*(g.closing_bracket), "expected ')' after formal parameter list");
+                  g.advance(*(g.colon), "expected ':' in function heading");
               }
 
               PNode ret = p.parse(1);
               if (!node_traits::has_type<IdentifierNode>(ret))
                   g.error("expected type identifier");
 
-              return std::make_shared<FunctionHeadingNode>(name, params, ret);
+              return make_node<FunctionHeadingNode>(name, params, ret);
          };
 
     }
@@ -1,37 +1,58 @@
 //#include <memory>
-//#include <forward_list>
 //#include <string>
 
 //#include "pascal_grammar.h"
-#include "list_guard.h"
+#include "list_mode.h"
 //#include "node_traits.h"
 
-#include <set>
-
 namespace pascal_grammar {
     void add_sections(PascalGrammar& g) {
 
         typedef PascalGrammar::RightAssociative RightAssociative;
 
-        static auto begins_new_section = [](const std::string& symbol) -> bool {
-            static const std::set<std::string> table = 
-                { "begin", "function", "procedure", 
-                  "type", "label", "var", "const", "" };
-            return table.find(symbol) != table.end();
+        static auto begins_new_section = [&g](const PrattParser<PNode>& p) -> bool {
+            const Symbol<PNode>* next = &p.next_token().symbol();
+            return next == g.begin || next == g.function || next == g.procedure ||
+                   next == g.type_ || next == g.label || next == g.var ||
+                   next == g.const_ || next == &g.get_symbols().end_symbol();
+        };
+
+        // a definition replaced by ErrorNode stops before its ';'
+        static auto skip_semicolon_after_error = [&g](PrattParser<PNode>& p, const PNode& x) {
+            if (node_traits::has_type<ErrorNode>(x) && p.next_is(*(g.semicolon)))
+                p.advance();
         };
 
         static auto opening_bracket_scan_enum = 
         [&g](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::list_guard<IdentifierNode> guard(g, g.comma, "identifier");
+            PascalGrammar::mode_guard guard(p, g.modes.enumerated_type);
             PNode x = p.parse(0);
-            g.advance(")", "expected closing ')'");
+            g.advance(*(g.closing_bracket), "expected closing ')'");
 
             if (!node_traits::is_list_of<IdentifierNode>(x))
                 g.error("expected list of identifiers");
 
-            return std::make_shared<EnumeratedTypeNode>(x);
+            return make_node<EnumeratedTypeNode>(x);
         };
 
+        // Modes of the sections
+        g.set_list<IdentifierNode>(g.modes.enumerated_type, g.comma, "identifier");
+
+        g.modes.variable_section.set_lbp(*(g.semicolon), 0)
+                                .set_nud(*(g.opening_bracket), opening_bracket_scan_enum);
+        g.set_list<IdentifierNode>(g.modes.variable_section, g.comma, "identifier");
+
+        g.modes.type_section.set_lbp(*(g.semicolon), 0)
+                            .set_lbp(*(g.sign_eq), 0)
+                            .set_nud(*(g.opening_bracket), opening_bracket_scan_enum);
+
+        g.modes.constant_section.set_lbp(*(g.semicolon), 0)
+                                .set_lbp(*(g.sign_eq), 0);
+
+        g.modes.label_section.set_lbp(*(g.semicolon), 0)
+                             .set_lbp(*(g.comma), 1);
+        g.set_list<IntegerNumberNode>(g.modes.label_section, g.comma, "integer number");
+
         // Variable declarations
         g.colon = &g.infix(":", 70, 
         [&g](PNode x, PNode y) -> PNode {
@@ -39,116 +60,109 @@ namespace pascal_grammar {
                 g.error("expected identifier list");
             if (!node_traits::is_type(y))
                 g.error("expected type name");
-            return std::make_shared<VariableDeclNode>(x, y);
+            return make_node<VariableDeclNode>(x, y);
         });
 
        g.var = &g.add_symbol_to_dict("var", 1);
-       g.var -> nud = [&g, opening_bracket_scan_enum](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
-
-            PascalGrammar::nud_guard open_bracket_guard(*(g.opening_bracket),
-                    opening_bracket_scan_enum);
-
-            PascalGrammar::list_guard<IdentifierNode> comma_guard(g, g.comma, "identifier");
+       g.var -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+            PascalGrammar::mode_guard guard(p, g.modes.variable_section);
             
-            std::forward_list<PNode> variable_declarations;
+            NodeList variable_declarations;
 
             do {
-                PNode x = p.parse(1);
-                if (!node_traits::has_type<VariableDeclNode>(x))
-                    g.error("expected variable declaration");
-                variable_declarations.push_front(x);
-
-                g.advance(";", "expected ';' after variable declaration");
-
-                if (begins_new_section(p.next_token_as_string()))
+                PNode x = g.recover([&]() -> PNode {
+                    PNode x = p.parse(1);
+                    if (!node_traits::has_type<VariableDeclNode>(x))
+                        g.error("expected variable declaration");
+                    g.advance(*(g.semicolon), "expected ';' after variable declaration");
+                    return x;
+                });
+                variable_declarations.push_back(x);
+                skip_semicolon_after_error(p, x);
+
+                if (begins_new_section(p))
                     break;
             } while (true);
 
-            variable_declarations.reverse();
-
-            return std::make_shared<VariableSectionNode>(
-                     std::make_shared<VariableDeclListNode>(
+            return make_node<VariableSectionNode>(
+                     make_node<VariableDeclListNode>(
                              std::move(variable_declarations)));
         };
 
         // Type declarations
-       g.add_symbol_to_dict("type", 1)
-        .nud = [&g, opening_bracket_scan_enum](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
-            PascalGrammar::lbp_guard equal_sign_guard(*(g.sign_eq), 0);
-
-            PascalGrammar::nud_guard open_bracket_guard(*(g.opening_bracket),
-                    opening_bracket_scan_enum);
+       g.type_ = &g.add_symbol_to_dict("type", 1);
+       g.type_ -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+            PascalGrammar::mode_guard guard(p, g.modes.type_section);
             
-            std::forward_list<PNode> type_definitions;
+            NodeList type_definitions;
 
             do {
-                PNode id = p.parse(1);
-                if (!node_traits::has_type<IdentifierNode>(id))
-                    g.error("expected identifier as a type name");
+                PNode definition = g.recover([&]() -> PNode {
+                    PNode id = p.parse(1);
+                    if (!node_traits::has_type<IdentifierNode>(id))
+                        g.error("expected identifier as a type name");
 
-                g.advance("=", "expected '=' after type name");
+                    g.advance(*(g.sign_eq), "expected '=' after type name");
 
-                PNode type = p.parse(1);
-                if (!node_traits::is_type(type))
-                    g.error("expected type definition after '='");
-                
-                g.advance(";", "expected ';' after type definition");
+                    PNode type = p.parse(1);
+                    if (!node_traits::is_type(type))
+                        g.error("expected type definition after '='");
+                    
+                    g.advance(*(g.semicolon), "expected ';' after type definition");
 
-                type_definitions.push_front(std::make_shared<TypeDefinitionNode>(id, type));
+                    return make_node<TypeDefinitionNode>(id, type);
+                });
+                type_definitions.push_back(definition);
+                skip_semicolon_after_error(p, definition);
 
-                if (begins_new_section(p.next_token_as_string()))
+                if (begins_new_section(p))
                     break;
             } while (true);
 
-            type_definitions.reverse();
-            return std::make_shared<TypeSectionNode>(std::move(type_definitions));
+            return make_node<TypeSectionNode>(std::move(type_definitions));
         };
 
         // Constant definitions
-       g.add_symbol_to_dict("const", 1)
-        .nud = [&g](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
-            PascalGrammar::lbp_guard equal_sign_guard(*(g.sign_eq), 0);
+       g.const_ = &g.add_symbol_to_dict("const", 1);
+       g.const_ -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+            PascalGrammar::mode_guard guard(p, g.modes.constant_section);
             
-            std::forward_list<PNode> const_defs;
+            NodeList const_defs;
             do {
-                PNode id = p.parse(0);
+                PNode definition = g.recover([&]() -> PNode {
+                    PNode id = p.parse(0);
 
-                if (!node_traits::has_type<IdentifierNode>(id))
-                    g.error("expected identifier in constant definition");
+                    if (!node_traits::has_type<IdentifierNode>(id))
+                        g.error("expected identifier in constant definition");
 
-                g.advance("=", "expected '=' after identifier");
+                    g.advance(*(g.sign_eq), "expected '=' after identifier");
 
-                PNode constant = p.parse(0);
+                    PNode constant = p.parse(0);
 
-                if (!node_traits::is_convertible_to<ConstantNode>(constant))
-                    g.error("expected constant after '='");
-                else
-                    constant = node::convert_to<ConstantNode>(constant);
+                    if (!node_traits::is_convertible_to<ConstantNode>(constant))
+                        g.error("expected constant after '='");
+                    else
+                        constant = node::convert_to<ConstantNode>(constant);
 
-                const_defs.push_front(
-                        std::make_shared<ConstDefinitionNode>(id, constant));
+                    g.advance(*(g.semicolon), "expected ';' after constant definition");
 
-                g.advance(";", "expected ';' after constant definition");
+                    return make_node<ConstDefinitionNode>(id, constant);
+                });
+                const_defs.push_back(definition);
+                skip_semicolon_after_error(p, definition);
 
-                if (begins_new_section(p.next_token_as_string()))
+                if (begins_new_section(p))
                     break;
             } while (true);
-            const_defs.reverse();
-            return std::make_shared<ConstSectionNode>(std::move(const_defs));
+            return make_node<ConstSectionNode>(std::move(const_defs));
         };
 
-       g.add_symbol_to_dict("label", 1)
-        .nud = [&g](PrattParser<PNode>& p) -> PNode {
-            PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
-            PascalGrammar::lbp_guard comma_lbp_guard(*(g.comma), 1);
-            PascalGrammar::list_guard<IntegerNumberNode> comma_guard(g, g.comma,
-                                                                "integer number");
+       g.label = &g.add_symbol_to_dict("label", 1);
+       g.label -> nud = [&g](PrattParser<PNode>& p) -> PNode {
+            PascalGrammar::mode_guard guard(p, g.modes.label_section);
             PNode labels = p.parse(0);
-            g.advance(";", "expected ';' after label section");
-            return std::make_shared<LabelSectionNode>(labels);
+            g.advance(*(g.semicolon), "expected ';' after label section");
+            return make_node<LabelSectionNode>(labels);
         };
     }
 } // namespace pascal_grammar
@@ -1,5 +1,5 @@
 //#include "pascal_grammar.h"
-#include "list_guard.h"
+#include "list_mode.h"
 
 #ifdef PRINT_DEBUG
 #include <iostream>
@@ -21,40 +21,43 @@ namespace pascal_grammar {
                         g.error("expected variable before ':=' token");
                     if (!node_traits::is_convertible_to<ExpressionNode>(expr))
                         g.error("expected expression after ':=' token");
-                    return std::make_shared<AssignmentStatementNode>(var, expr);
+                    return make_node<AssignmentStatementNode>(var, expr);
                 });
 
+       static auto process_if_identifier = [](PNode& node) {
+            if (node_traits::has_type<IdentifierNode>(node)) {
+                 // function/procedure call
+                node = make_node<FunctionDesignatorNode>(node,
+                           make_node<ExpressionListNode>());
+            }
+       };
+
+       static auto statement_is_empty = [&g]() -> bool {
+           const PrattParser<PNode>& p = g.parser();
+           return p.next_is(*(g.semicolon)) || p.next_is(*(g.end)) || 
+                  p.next_is(*(g.until)) || p.next_is(*(g.else_));
+       };
+
+       g.modes.statement.set_lbp(*(g.colon), 1)
+                        .set_led(*(g.colon),
+           [&g](PrattParser<PNode>& p, PNode left) -> PNode {
+                if (!node_traits::is_convertible_to<IntegerNumberNode>(left))
+                    g.error("expected integer number as label");
+                if (statement_is_empty())
+                    return make_node<EmptyNode>();
+                PNode node = p.parse(0);
+                process_if_identifier(node);
+                if (!node_traits::is_convertible_to<StatementNode>(node))
+                    g.error("expected statement");
+                return make_node<LabeledStatementNode>(left, node);
+           });
+
        static auto parse_statement = [&g]() -> PNode {
-           static auto process_if_identifier = [](PNode& node) {
-                if (node_traits::has_type<IdentifierNode>(node)) {
-                     // function/procedure call
-                    node = std::make_shared<FunctionDesignatorNode>(node,
-                               std::make_shared<ExpressionListNode>());
-                }
-           };
-
-           static auto statement_is_empty = [&g]() -> bool {
-               auto next = g.parser -> next_token_as_string();
-               return (next == ";" || next == "end" || next == "until" || next == "else");
-           };
-
-           PrattParser<PNode>& p = *(g.parser);
-           PascalGrammar::lbp_guard colon_lbp_guard(*(g.colon), 1);
-           PascalGrammar::led_guard colon_guard(*(g.colon),
-               [&g](PrattParser<PNode>& p, PNode left) -> PNode {
-                    if (!node_traits::is_convertible_to<IntegerNumberNode>(left))
-                        g.error("expected integer number as label");
-                    if (statement_is_empty())
-                        return std::make_shared<EmptyNode>();
-                    PNode node = p.parse(0);
-                    process_if_identifier(node);
-                    if (!node_traits::is_convertible_to<StatementNode>(node))
-                        g.error("expected statement");
-                    return std::make_shared<LabeledStatementNode>(left, node);
-               });
+           PrattParser<PNode>& p = g.parser();
+           PascalGrammar::mode_guard guard(p, g.modes.statement);
 
            if (statement_is_empty())
-               return std::make_shared<EmptyNode>();
+               return make_node<EmptyNode>();
            PNode node = p.parse(0);
            process_if_identifier(node);
            if (!node_traits::is_convertible_to<StatementNode>(node))
@@ -63,43 +66,49 @@ namespace pascal_grammar {
        };
 
        static auto parse_statement_sequence = [&g]() -> PNode {
-           PrattParser<PNode>& p = *(g.parser);
-           std::forward_list<PNode> statements;
+           PrattParser<PNode>& p = g.parser();
+           NodeList statements;
            while (true) {
-               auto next = p.next_token_as_string();
-               if (next == ";") { // some support for empty statements
+               if (p.next_is(*(g.semicolon))) { // some support for empty statements
                    p.advance();
                }
-               next = p.next_token_as_string();
-               if (next == "end" || next == "until")
+               if (p.next_is(*(g.end)) || p.next_is(*(g.until)))
                    break;
-               PNode statement = parse_statement();
-               statements.push_front(statement);
-               next = p.next_token_as_string();
-               if (next != ";") {
+               PNode statement = g.recover(parse_statement);
+               statements.push_back(statement);
+               if (!p.next_is(*(g.semicolon))) {
+                   if (g.collects_errors() && p.next_is(*(g.begin)))
+                       continue; // skipped up to the next statement
+                   if (g.collects_errors() && !p.next_is(*(g.end)) && !p.next_is(*(g.until))
+                           && (p.next_token().is_literal() || p.nud_of(p.next_token().symbol())))
+                   {
+                       g.report("expected ';' between statements");
+                       continue;
+                   }
                    break; // handling errors is duty of the caller
                }
            }
-           statements.reverse();
-           return std::make_shared<StatementListNode>(std::move(statements));
+           return make_node<StatementListNode>(std::move(statements));
        };
 
 
-       g.add_symbol_to_dict("begin", 1)
-        .nud = [&g](PrattParser<PNode>& p) -> PNode {
+       g.modes.compound_statement.set_lbp(*(g.end), 0)
+                                 .set_lbp(*(g.dot), 1000);
+
+       g.begin = &g.add_symbol_to_dict("begin", 1);
+       g.begin -> nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
             cout << "ENTERING BEGIN" << endl;
 #endif
-            PascalGrammar::lbp_guard end_guard(*(g.end), 0);
-            PascalGrammar::lbp_guard dot_guard(*(g.dot), 1000);
+            PascalGrammar::mode_guard guard(p, g.modes.compound_statement);
 
             PNode statements = parse_statement_sequence();
 
-            g.advance("end", "expected 'end' after statement-sequence");
-            return std::make_shared<CompoundStatementNode>(statements);
+            g.advance(*(g.end), "expected 'end' after statement-sequence");
+            return make_node<CompoundStatementNode>(statements);
         };
 
-       g.add_symbol_to_dict("do", 0);
+       g.do_ = &g.add_symbol_to_dict("do", 0);
        g.add_symbol_to_dict("while", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
@@ -108,27 +117,27 @@ namespace pascal_grammar {
             PNode condition = p.parse(0);
             if (!node_traits::is_convertible_to<ExpressionNode>(condition))
                 g.error("expected expression after 'while'");
-            g.advance("do", "expected 'do' after expression");
+            g.advance(*(g.do_), "expected 'do' after expression");
             PNode body = parse_statement();
-            return std::make_shared<WhileStatementNode>(condition, body);
+            return make_node<WhileStatementNode>(condition, body);
         };
 
-       g.add_symbol_to_dict("until", 0);
+       g.until = &g.add_symbol_to_dict("until", 0);
        g.add_symbol_to_dict("repeat", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
             cout << "ENTERING REPEAT LOOP" << endl;
 #endif
             PNode body = parse_statement_sequence();
-            g.advance("until", "expected 'until' after statement-sequence");
+            g.advance(*(g.until), "expected 'until' after statement-sequence");
             PNode condition = p.parse(1); // stop before semicolon
             if (!node_traits::is_convertible_to<ExpressionNode>(condition))
                 g.error("expected expression after 'until'");
-            return std::make_shared<RepeatStatementNode>(body, condition);
+            return make_node<RepeatStatementNode>(body, condition);
         };
 
-       g.add_symbol_to_dict("to", 0);
-       g.add_symbol_to_dict("downto", 0);
+       g.to = &g.add_symbol_to_dict("to", 0);
+       g.downto = &g.add_symbol_to_dict("downto", 0);
        g.add_symbol_to_dict("for", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
@@ -136,33 +145,32 @@ namespace pascal_grammar {
 #endif
             PNode assignment = parse_statement();
             if (!node_traits::has_type<AssignmentStatementNode>(assignment))
-                g.error("expected assignment-statement after 'for'");
+                return g.error("expected assignment-statement after 'for'");
             auto _assignment = std::static_pointer_cast<AssignmentStatementNode>(assignment);
             if (!node_traits::has_type<IdentifierNode>(_assignment -> variable))
                 g.error("expected identifier after 'for'");
             int sign;
-            std::string next = p.next_token_as_string();
-            if (next == "to") {
+            if (p.next_is(*(g.to))) {
                 sign = 1;
-            } else if (next == "downto") {
+            } else if (p.next_is(*(g.downto))) {
                 sign = -1;
             } else {
-                g.error("expected 'to' or 'downto' after initial-expression");
+                return g.error("expected 'to' or 'downto' after initial-expression");
             }
             p.advance();
             PNode final_expr = p.parse(1);
             if (!node_traits::is_convertible_to<ExpressionNode>(final_expr)) {
                 std::string msg = "expected final-expression after ";
-                msg = msg + '\'' + next + '\'';
+                msg = msg + '\'' + (sign > 0 ? "to" : "downto") + '\'';
                 g.error(std::move(msg));
             }
-            g.advance("do", "expected 'do' after final-expression");
+            g.advance(*(g.do_), "expected 'do' after final-expression");
             PNode body = parse_statement();
-            return std::make_shared<ForStatementNode>(_assignment, sign, final_expr, body);
+            return make_node<ForStatementNode>(_assignment, sign, final_expr, body);
         };
 
-       g.add_symbol_to_dict("then", 0);
-       g.add_symbol_to_dict("else", 0);
+       g.then = &g.add_symbol_to_dict("then", 0);
+       g.else_ = &g.add_symbol_to_dict("else", 0);
        g.add_symbol_to_dict("if", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
@@ -171,31 +179,42 @@ namespace pascal_grammar {
             PNode expr = p.parse(1);
             if (!node_traits::is_convertible_to<ExpressionNode>(expr))
                 g.error("expected expression after 'if'");
-            g.advance("then", "expected 'then'");
+            g.advance(*(g.then), "expected 'then'");
             PNode st = parse_statement();
-            if (p.next_token_as_string() != "else") {
-                return std::make_shared<IfThenNode>(expr, st);
+            if (!p.next_is(*(g.else_))) {
+                return make_node<IfThenNode>(expr, st);
             } else {
                 p.advance();
-                return std::make_shared<IfThenElseNode>(expr, st, parse_statement());
+                return make_node<IfThenElseNode>(expr, st, parse_statement());
             }
         };
 
-       g.add_symbol_to_dict("do", 0);
+       g.set_list<VariableNode>(g.modes.with_statement, g.comma, "record variable");
+
        g.add_symbol_to_dict("with", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
             cout << "ENTERING WITH STATEMENT" << endl;
 #endif
-            PascalGrammar::list_guard<VariableNode> comma_guard(g, g.comma, "record variable");
+            PascalGrammar::mode_guard guard(p, g.modes.with_statement);
             PNode list = p.parse(0);
             if (!node_traits::is_list_of<VariableNode>(list))
                 g.error("expected list of record variables after 'with'");
-            g.advance("do", "expected 'do' in with-statement");
+            g.advance(*(g.do_), "expected 'do' in with-statement");
             PNode st = parse_statement();
-            return std::make_shared<WithStatementNode>(list, st);
+            return make_node<WithStatementNode>(list, st);
         };
 
+       g.set_list<ConstantNode>(g.modes.case_statement, g.comma, "constant");
+       g.modes.case_statement.set_lbp(*(g.colon), 1)
+                             .set_led(*(g.colon),
+            [&g](PrattParser<PNode>& p, PNode left) -> PNode {
+                if (!node_traits::is_list_of<ConstantNode>(left))
+                    g.error("expected list of constants before ':'");
+                return make_node<CaseLimbNode>(left, parse_statement());
+            })
+                             .set_lbp(*(g.semicolon), 0);
+
        g.add_symbol_to_dict("case", 1)
         .nud = [&g](PrattParser<PNode>& p) -> PNode {
 #ifdef PRINT_DEBUG
@@ -204,123 +223,111 @@ namespace pascal_grammar {
             PNode expr = p.parse(0);
             if (!node_traits::is_convertible_to<ExpressionNode>(expr))
                 g.error("expected expression after 'case'");
-            g.advance("of", "expected 'of' after expression");
-
-            PascalGrammar::list_guard<ConstantNode> comma_guard(g, g.comma, "constant");
-            PascalGrammar::lbp_guard colon_lbp_guard(*(g.colon), 1);
-            PascalGrammar::led_guard colon_guard(*(g.colon),
-                [&g](PrattParser<PNode>& p, PNode left) -> PNode {
-                    if (!node_traits::is_list_of<ConstantNode>(left))
-                        g.error("expected list of constants before ':'");
-                    return std::make_shared<CaseLimbNode>(left, parse_statement());
-                });
+            g.advance(*(g.of), "expected 'of' after expression");
 
-            PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
+            PascalGrammar::mode_guard guard(p, g.modes.case_statement);
             
-            std::forward_list<PNode> limbs;
+            NodeList limbs;
 
             do {
                 PNode limb = p.parse(0);
                 if (!node_traits::has_type<CaseLimbNode>(limb))
-                    g.error("expected case-limb");
-                limbs.push_front(limb);
-                std::string next = p.next_token_as_string();
-                if (next == ";") {
+                    return g.error("expected case-limb");
+                limbs.push_back(limb);
+                if (p.next_is(*(g.semicolon))) {
                     p.advance();
-                    if (p.next_token_as_string() == "end") {
+                    if (p.next_is(*(g.end))) {
                         p.advance();
                         break;
                     }
-                } else if (next == "end") {
+                } else if (p.next_is(*(g.end))) {
                     p.advance();
                     break;
                 } else {
-                    g.error("expected ';' or 'end'");
+                    return g.error("expected ';' or 'end'");
                 }
             } while (true);
 
-            limbs.reverse();
-            return std::make_shared<CaseStatementNode>(expr,
-                    std::make_shared<CaseLimbListNode>(std::move(limbs)));
+            return make_node<CaseStatementNode>(expr,
+                    make_node<CaseLimbListNode>(std::move(limbs)));
         };
 
+       g.modes.output_list.set_lbp(*(g.comma), 0)
+                          .set_lbp(*(g.colon), 0);
+
        auto parse_output_list = [&g]() -> PNode {
-            PrattParser<PNode>& p = *(g.parser);
-            PascalGrammar::lbp_guard comma_guard(*(g.comma), 0);
-            PascalGrammar::lbp_guard colon_guard(*(g.colon), 0);
-            std::forward_list<PNode> output;
+            PrattParser<PNode>& p = g.parser();
+            PascalGrammar::mode_guard guard(p, g.modes.output_list);
+            NodeList output;
             do {
                 PNode val = p.parse(0);
                 if (!node_traits::is_convertible_to<ExpressionNode>(val))
-                    g.error("expected expression as output value");
+                    return g.error("expected expression as output value");
 
-                output.push_front(val);
-                PNode& last_value = output.front();
+                output.push_back(val);
+                PNode& last_value = output.back();
 
-                auto next = p.next_token_as_string();
-                if (next == ",") {
+                if (p.next_is(*(g.comma))) {
                     p.advance();
                     continue;
                 }
-                else if (next == ")") {
+                else if (p.next_is(*(g.closing_bracket))) {
                     break;
                 }
 
-                if (next != ":")
-                    g.error("expected ':', ',' or ')'");
+                if (!p.next_is(*(g.colon)))
+                    return g.error("expected ':', ',' or ')'");
 
                 p.advance(); // skip ':'
                 PNode field_width, fraction_length;
                 field_width = p.parse(0);
                 if (!node_traits::is_convertible_to<ExpressionNode>(field_width))
-                    g.error("expected expression as field width");
-                if (p.next_token_as_string() == ":") {
+                    return g.error("expected expression as field width");
+                if (p.next_is(*(g.colon))) {
                     p.advance();
                     fraction_length = p.parse(0);
                     if (!node_traits::is_convertible_to<ExpressionNode>(fraction_length))
-                        g.error("expected expression as fraction length");
+                        return g.error("expected expression as fraction length");
                 }
-                last_value = std::make_shared<OutputValueNode>(last_value, field_width, 
+                last_value = make_node<OutputValueNode>(last_value, field_width, 
                                          fraction_length ? 
                                          fraction_length : 
-                                         std::make_shared<OutputValueNode>(last_value,
-                                             field_width, std::make_shared<EmptyNode>()));
-                next = p.next_token_as_string();
-                if (next == ",") {
+                                         make_node<OutputValueNode>(last_value,
+                                             field_width, make_node<EmptyNode>()));
+                if (p.next_is(*(g.comma))) {
                     p.advance();
                     continue;
                 }
-                else if (next == ")") {
+                else if (p.next_is(*(g.closing_bracket))) {
                     break;
                 }
-                else g.error("expected ',' or ')' after output value");
+                else return g.error("expected ',' or ')' after output value");
             } while (true);
-            output.reverse();
-            return std::make_shared<OutputValueListNode>(std::move(output));
+            return make_node<OutputValueListNode>(std::move(output));
        };
 
        g.add_symbol_to_dict("write", 1)
         .nud = [&g, parse_output_list](PrattParser<PNode>& p) -> PNode {
-            g.advance("(", "expected list of values to output");
+            g.advance(*(g.opening_bracket), "expected list of values to output");
             PNode output = parse_output_list();
-            g.advance(")", "expected closing ')' in 'write'");
-            return std::make_shared<WriteNode>(output);
+            g.advance(*(g.closing_bracket), "expected closing ')' in 'write'");
+            return make_node<WriteNode>(output);
         };
 
        g.add_symbol_to_dict("writeln", 1)
         .nud = [&g, parse_output_list](PrattParser<PNode>& p) -> PNode {
-            if (p.next_token_as_string() != "(")
-                return std::make_shared<WriteLineNode>(std::make_shared<OutputValueListNode>());
+            if (!p.next_is(*(g.opening_bracket)))
+                return make_node<WriteLineNode>(make_node<OutputValueListNode>());
             p.advance();
             PNode output = parse_output_list();
-            g.advance(")", "expected closing ')' in 'writeln'");
-            return std::make_shared<WriteLineNode>(output);
+            g.advance(*(g.closing_bracket), "expected closing ')' in 'writeln'");
+            return make_node<WriteLineNode>(output);
         };
 
       g.prefix("goto", std::numeric_limits<int>::max(), [&g](PNode node) -> PNode {
             if (!node_traits::is_convertible_to<IntegerNumberNode>(node))
                 g.error("expected label");
-            return std::make_shared<GotoStatementNode>(node);
+            return make_node<GotoStatementNode>(node);
           });
     }
 }
@@ -4,7 +4,7 @@
 //#include "pascal_grammar.h"
 //#include "node_traits.h"
 //#include "node_fwd.h"
-#include "list_guard.h"
+#include "list_mode.h"
 
 namespace pascal_grammar {
 
@@ -13,8 +13,7 @@ namespace pascal_grammar {
 
        g.comma = &g.infix_r(",", 80, 
             [&g](PNode x, PNode y) -> PNode {
-                g.error("unexpected ','");
-                return nullptr;
+                return g.error("unexpected ','");
             });
 
        g.range = &g.infix("..", 90, 
@@ -23,154 +22,156 @@ namespace pascal_grammar {
                     g.error("expected a constant as the lower bound");
                 if (!node_traits::is_convertible_to<ConstantNode>(y))
                     g.error("expected a constant as the upper bound");
-                return std::make_shared<SubrangeTypeNode>(x, y);
+                return make_node<SubrangeTypeNode>(x, y);
             });
 
         g.prefix("^", 80, 
              [&g](PNode x) -> PNode {
                  if (!node_traits::has_type<IdentifierNode>(x)) 
                      g.error("expected identifier after '^'");
-                 return std::make_shared<PointerTypeNode>(x);
+                 return make_node<PointerTypeNode>(x);
             });
 
         g.semicolon = &g.add_symbol_to_dict(";", 0);
+        g.of = &g.add_symbol_to_dict("of", 0);
+        g.end = &g.add_symbol_to_dict("end", 0);
+        g.case_ = &g.add_symbol_to_dict("case", 0);
+
+        g.modes.field_list.set_lbp(*(g.semicolon), 0);
+        g.set_list<IdentifierNode>(g.modes.field_list, g.comma, "identifier");
+
+        g.modes.variant_part.set_lbp(*(g.comma), std::numeric_limits<int>::max());
+        g.set_list<ConstantNode>(g.modes.variant_part, g.comma, "constant");
+
+        g.set_list<IndexTypeNode>(g.modes.index_types, g.comma, "index type");
 
         static struct {
             PNode operator()(PascalGrammar& g) {
-                PrattParser<PNode>& p = *(g.parser);
+                PrattParser<PNode>& p = g.parser();
 
-                PascalGrammar::lbp_guard semicolon_guard(*(g.semicolon), 0);
-                PascalGrammar::list_guard<IdentifierNode> comma_guard(g, g.comma, "identifier");
+                PascalGrammar::mode_guard guard(p, g.modes.field_list);
                 
-                auto next = p.next_token_as_string();
-                if (next == ";") {
+                /* ')' or 'end' follows the field list */
+                auto ends_field_list = [&g, &p]() -> bool {
+                    return p.next_is(*(g.closing_bracket)) || p.next_is(*(g.end));
+                };
+
+                if (p.next_is(*(g.semicolon))) {
                     p.advance();
-                    next = p.next_token_as_string();
-                    if (next == ")" || next == "end") {
-                    return std::make_shared<FieldListNode>(
-                        std::make_shared<EmptyNode>(), std::make_shared<EmptyNode>());
+                    if (ends_field_list()) {
+                    return make_node<FieldListNode>(
+                        make_node<EmptyNode>(), make_node<EmptyNode>());
                     } else {
-                        g.error("expected 'end' or ')' after ';'");
+                        return g.error("expected 'end' or ')' after ';'");
                     }
                 }
-                if (next == ")" || next == "end") {
-                    return std::make_shared<FieldListNode>(
-                            std::make_shared<EmptyNode>(), std::make_shared<EmptyNode>());
+                if (ends_field_list()) {
+                    return make_node<FieldListNode>(
+                            make_node<EmptyNode>(), make_node<EmptyNode>());
                 }
                 PNode fixed_part;
                 PNode variant_part;
-                if (next != "case") {
+                if (!p.next_is(*(g.case_))) {
                     // parse fixed part
-                    std::forward_list<PNode> record_sections;
+                    NodeList record_sections;
                     while (true) {
                         PNode sect = p.parse(1);
                         if (!node_traits::has_type<VariableDeclNode>(sect))
-                            g.error("expected record section");
-                        record_sections.push_front(
-                            std::make_shared<RecordSectionNode>(
+                            return g.error("expected record section");
+                        record_sections.push_back(
+                            make_node<RecordSectionNode>(
                                 std::static_pointer_cast<VariableDeclNode>(sect)));
-                        auto next = p.next_token_as_string();
-                        if (next == ")" || next == "end") {
-                            record_sections.reverse();
-                            fixed_part = std::make_shared<FixedPartNode>(std::move(record_sections));
+                        if (ends_field_list()) {
+                            fixed_part = make_node<FixedPartNode>(std::move(record_sections));
                             break;
                         }
-                        g.advance(";", "expected ';' after record section");
-                        next = p.next_token_as_string();
-                        if (next == "case" || next == ")" || next == "end") {
-                            record_sections.reverse();
-                            fixed_part = std::make_shared<FixedPartNode>(std::move(record_sections));
+                        g.advance(*(g.semicolon), "expected ';' after record section");
+                        if (p.next_is(*(g.case_)) || ends_field_list()) {
+                            fixed_part = make_node<FixedPartNode>(std::move(record_sections));
                             break;
                         }
                     }
                 }
-                if (p.next_token_as_string() == "case") {
+                if (p.next_is(*(g.case_))) {
                     PNode tag_field, type_id;
                     p.advance(); // skip 'case'
                     type_id = p.parse(70); // colon lbp
                     if (!node_traits::has_type<IdentifierNode>(type_id))
                         g.error("expected identifier in variant part");
-                    auto next = p.next_token_as_string();
-                    if (next == ":") {
+                    if (p.next_is(*(g.colon))) {
                         tag_field = std::move(type_id);
                         p.advance();
                         type_id = p.parse(0);
                         if (!node_traits::has_type<IdentifierNode>(type_id))
                             g.error("expected type identifier");
                     }
-                    g.advance("of", "expected 'of' in variant part");
+                    g.advance(*(g.of), "expected 'of' in variant part");
 
-                    PascalGrammar::lbp_guard comma_lbp_guard(*(g.comma), std::numeric_limits<int>::max());
-                    PascalGrammar::list_guard<ConstantNode> comma_guard(g, g.comma, "constant");
+                    PascalGrammar::mode_guard variant_guard(p, g.modes.variant_part);
 
-                    std::forward_list<PNode> variants;
+                    NodeList variants;
                     while (true) {
                         PNode case_label_list = p.parse(std::numeric_limits<int>::max() - 1);
                         if (!node_traits::is_list_of<ConstantNode>(case_label_list))
-                            g.error("expected case label list");
-                        g.advance(":", "expected ':' after case label list");
-                        g.advance("(", "expected '(' token after ':'");
+                            return g.error("expected case label list");
+                        g.advance(*(g.colon), "expected ':' after case label list");
+                        g.advance(*(g.opening_bracket), "expected '(' token after ':'");
                         PNode field_list = operator()(g);
                         if (!node_traits::has_type<FieldListNode>(field_list))
-                            g.error("expected field list");
-                        g.advance(")", "expected ')' token");
+                            return g.error("expected field list");
+                        g.advance(*(g.closing_bracket), "expected ')' token");
 
-                        variants.push_front(std::make_shared<FieldVariantNode>(
+                        variants.push_back(make_node<FieldVariantNode>(
                                     case_label_list, field_list));
 
-                        auto next = p.next_token_as_string();
-                        if (next != ";") {
-                            variants.reverse();
-                            variant_part = std::make_shared<VariantPartNode>(std::move(variants));
+                        if (!p.next_is(*(g.semicolon))) {
+                            variant_part = make_node<VariantPartNode>(std::move(variants));
                             break;
                         }
-                        // next == ";"
-                        p.advance();
+                        p.advance(); // skip ';'
+
                         /* this might be the end of field list in two cases:
                          * 1) record ... ; end
                          * 2) case ... of ... : ( ... ; )
                          */
-                        next = p.next_token_as_string();
-                        if (next == ")" || next == "end") {
-                            variants.reverse();
-                            variant_part = std::make_shared<VariantPartNode>(std::move(variants));
+                        if (ends_field_list()) {
+                            variant_part = make_node<VariantPartNode>(std::move(variants));
                             break;
                         }
                     }
                 }
-                return std::make_shared<FieldListNode>(
-                        fixed_part ? fixed_part : std::make_shared<EmptyNode>(),
-                        variant_part ? variant_part : std::make_shared<EmptyNode>());
+                return make_node<FieldListNode>(
+                        fixed_part ? fixed_part : make_node<EmptyNode>(),
+                        variant_part ? variant_part : make_node<EmptyNode>());
             }
         } parse_field_list;
 
-        g.end = &g.add_symbol_to_dict("end", 0);
         g.add_symbol_to_dict("record", std::numeric_limits<int>::max())
         .nud = [&g](PrattParser<PNode>&) -> PNode {
             PNode field_list = parse_field_list(g);
             if (!node_traits::has_type<FieldListNode>(field_list))
                 g.error("expected field list");
-            g.advance("end", "expected 'end'");
-            return std::make_shared<RecordTypeNode>(field_list);
+            g.advance(*(g.end), "expected 'end'");
+            return make_node<RecordTypeNode>(field_list);
             };
 
        g.add_symbol_to_dict("set", 1)
-        .nud = [](PrattParser<PNode>& p) -> PNode {
-            return std::make_shared<SetTypeNode>( p.advance("of").parse(1) );
+        .nud = [&g](PrattParser<PNode>& p) -> PNode {
+            return make_node<SetTypeNode>( p.advance(*(g.of)).parse(1) );
         };
 
        g.add_symbol_to_dict("file", 1)
-        .nud = [](PrattParser<PNode>& p) -> PNode {
-            return std::make_shared<FileTypeNode>( p.advance("of").parse(1) );
+        .nud = [&g](PrattParser<PNode>& p) -> PNode {
+            return make_node<FileTypeNode>( p.advance(*(g.of)).parse(1) );
         };
 
        g.array = &g.add_symbol_to_dict("array", 1);
        g.array -> nud = [&g](PrattParser<PNode>& p) -> PNode {
             PNode bounds;
             {
-                g.advance("[", "expected '[' after 'array'");
+                g.advance(*(g.opening_square_bracket), "expected '[' after 'array'");
 
-                PascalGrammar::list_guard<IndexTypeNode> guard(g, g.comma, "index type");
+                PascalGrammar::mode_guard guard(p, g.modes.index_types);
                 bounds = p.parse(10);
                 if (node_traits::is_convertible_to<IndexTypeNode>(bounds))
                     bounds = node::make_list(node::convert_to<IndexTypeNode>(bounds));
@@ -178,23 +179,22 @@ namespace pascal_grammar {
                     g.error("expected list of index types");
             }
 
-            g.advance("]", "expected ']' in array type definition");
-            g.advance("of", "expected 'of' in array type definition");
+            g.advance(*(g.closing_square_bracket), "expected ']' in array type definition");
+            g.advance(*(g.of), "expected 'of' in array type definition");
 
             PNode type = p.parse(1);
             if (!node_traits::is_type(type)) 
                 g.error("expected type in array type definition");
-            return std::make_shared<ArrayTypeNode>(bounds, type);
+            return make_node<ArrayTypeNode>(bounds, type);
         };
 
        g.packed = &g.add_symbol_to_dict("packed", 1);
        g.packed -> nud = [&g](PrattParser<PNode>& p) -> PNode {
             PNode type = p.parse(1);
             if (!node_traits::is_unpacked_structured_type(type)) {
-                g.error("expected unpacked structured type after 'packed'");
-                return nullptr;
+                return g.error("expected unpacked structured type after 'packed'");
             } else {
-                return std::make_shared<PackedTypeNode>(type);
+                return make_node<PackedTypeNode>(type);
             }
         };
     }
@@ -0,0 +1,113 @@
+#include "incremental_parser.h"
+#include "node.h"
+#include "node_traits.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace {
+    /// Declarations of the block of a program, procedure or function
+    DeclarationListNode::ListT& declarations_of(const PNode& owner) {
+        PNode block;
+        if (node_traits::has_type<ProgramNode>(owner))
+            block = std::static_pointer_cast<ProgramNode>(owner) -> block;
+        else if (node_traits::has_type<ProcedureNode>(owner))
+            block = std::static_pointer_cast<ProcedureNode>(owner) -> body;
+        else
+            block = std::static_pointer_cast<FunctionNode>(owner) -> body;
+        PNode list = std::static_pointer_cast<BlockNode>(block) -> declarations;
+        return std::static_pointer_cast<DeclarationListNode>(list) -> list();
+    }
+}
+
+IncrementalParser::IncrementalParser(std::string text) : text_(std::move(text)) {
+    parse_all();
+}
+
+const std::string& IncrementalParser::text() const {
+    return text_;
+}
+
+const PNode& IncrementalParser::ast() const {
+    return ast_;
+}
+
+void IncrementalParser::parse_all() {
+    ast_.reset();
+    routines.clear();
+    std::vector<RoutineSpan> spans;
+    PNode ast = PascalGrammar::parse(text_, spans);
+    routines.swap(spans);
+    ast_ = ast;
+}
+
+long IncrementalParser::innermost(const TextEdit& edit) const {
+    // the last routine beginning before the edit, or one of the routines around it
+    auto after = std::lower_bound(routines.begin(), routines.end(), edit.offset,
+        [](const RoutineSpan& r, size_t offset) { return r.begin < offset; });
+    long i = long(after - routines.begin()) - 1;
+    while (i >= 0) {
+        const RoutineSpan& span = routines[i];
+        if (edit.offset + edit.removed < span.end)
+            return i;
+        if (span.depth == 0)
+            return -1; // routines before it end before it begins
+        unsigned depth = span.depth;
+        while (routines[i].depth >= depth) // to the enclosing routine
+            --i;
+    }
+    return -1;
+}
+
+bool IncrementalParser::reparse(size_t index, const TextEdit& edit) {
+    const RoutineSpan old = routines[index];
+    long delta = long(edit.inserted.size()) - long(edit.removed);
+    std::string region = text_.substr(old.begin, old.end - old.begin + delta);
+
+    std::vector<RoutineSpan> spans;
+    PNode node;
+    try {
+        node = PascalGrammar::parse_routine(region, spans);
+    } catch (SyntaxError&) {
+        return false; // may be fine in the context of the whole program
+    }
+
+    long parent = long(index) - 1;
+    while (parent >= 0 && routines[parent].depth >= old.depth)
+        --parent;
+    auto& siblings = declarations_of(old.depth == 0 ? ast_ : routines[parent].node);
+    std::replace(siblings.begin(), siblings.end(), old.node, node);
+
+    // routines around the edited one end later, routines after it move
+    for (size_t i = 0; i < index; ++i) {
+        if (routines[i].end > old.begin)
+            routines[i].end += delta;
+    }
+    size_t next = index;
+    while (next < routines.size() && routines[next].begin < old.end)
+        ++next;
+    for (size_t i = next; i < routines.size(); ++i) {
+        routines[i].begin += delta;
+        routines[i].end += delta;
+    }
+
+    for (size_t i = 0; i < spans.size(); ++i) {
+        spans[i].begin += old.begin;
+        spans[i].end += old.begin;
+        spans[i].depth += old.depth;
+    }
+    routines.erase(routines.begin() + index, routines.begin() + next);
+    routines.insert(routines.begin() + index, spans.begin(), spans.end());
+    return true;
+}
+
+bool IncrementalParser::edit(const TextEdit& edit) {
+    if (edit.offset > text_.size() || edit.removed > text_.size() - edit.offset)
+        throw std::out_of_range("edit is outside of the text");
+    long index = ast_ ? innermost(edit) : -1;
+    text_.replace(edit.offset, edit.removed, edit.inserted);
+    if (index >= 0 && reparse(index, edit))
+        return true;
+    parse_all();
+    return false;
+}
@@ -1,8 +1,9 @@
 //#include <memory>
-//#include <forward_list>
 //#include <string>
 
 #include "node.h"
+#include "node_arena.h"
+#include "pascal_literals.h"
 //#include "node_tags.h"
 //#include "operator.h"
 
@@ -11,6 +12,8 @@ size_t Node::tag() {
     return node_traits::get_tag_value<Node>();
 }
 
+ErrorNode::ErrorNode(const std::string& message) : message(message) {}
+
 OperationNode::OperationNode(int arity, Operator op) : _arity(arity), _op(op) {}
 int OperationNode::arity() { return _arity; }
 int OperationNode::op() { return _op; }
@@ -19,13 +22,29 @@ SignNode::SignNode(char sign, const PNode& child) :
     child(child), _sign(sign) {}
 char SignNode::sign() { return _sign; }
 
-UIntegerNumberNode::UIntegerNumberNode(std::string val) : value(val) {}
-URealNumberNode::URealNumberNode(std::string significand, std::string exponent) :
-    significand(significand), exponent(exponent) {}
+UIntegerNumberNode::UIntegerNumberNode(uint64_t value, size_t position, size_t length) : 
+    value(value), position(position), length(length) {}
+
+URealNumberNode::URealNumberNode(double value, size_t position, size_t length) : 
+    value(value), position(position), length(length) {}
+
+std::string URealNumberNode::significand() const {
+    std::string significand;
+    int exponent;
+    pascal::format_real(value, significand, exponent);
+    return significand;
+}
+
+int URealNumberNode::exponent() const {
+    std::string significand;
+    int exponent;
+    pascal::format_real(value, significand, exponent);
+    return exponent;
+}
 
 IntegerNumberNode::IntegerNumberNode(const PNode& value, char sign) : value(value), sign(sign) {}
 RealNumberNode::RealNumberNode(const PNode& value, char sign) : value(value), sign(sign) {}
-IdentifierNode::IdentifierNode(std::string s) : name(s) {}
+IdentifierNode::IdentifierNode(Atom name, Atom spelling) : name(name), spelling(spelling) {}
 StringNode::StringNode(std::string s) : str(s) {}
 ConstantNode::ConstantNode(const PNode& node) : child(node) {}
 
@@ -127,13 +146,13 @@ VariableParameterNode::VariableParameterNode(const PNode& ids, const PNode& t) :
 ValueParameterNode::ValueParameterNode(const PNode& ids, const PNode& t) :
         identifiers(ids), type(t) {}
 
-ProcedureHeadingNode::ProcedureHeadingNode(const std::string& name, const PNode& params) :
+ProcedureHeadingNode::ProcedureHeadingNode(Atom name, const PNode& params) :
         name(name), params(params) {}
 
-FunctionHeadingNode::FunctionHeadingNode(const std::string& name, const PNode& params,
+FunctionHeadingNode::FunctionHeadingNode(Atom name, const PNode& params,
         const PNode& return_type) : name(name), params(params), return_type(return_type) {}
 
-FunctionIdentificationNode::FunctionIdentificationNode(const std::string& name) : name(name) {}
+FunctionIdentificationNode::FunctionIdentificationNode(Atom name) : name(name) {}
 
 ParameterNode::ParameterNode(const PNode& child) : child(child) {}
 
@@ -175,9 +194,9 @@ LabeledStatementNode::LabeledStatementNode(const PNode& label, const PNode& stat
 LabelSectionNode::LabelSectionNode(const PNode& list) : list(list) {}
 GotoStatementNode::GotoStatementNode(const PNode& label) : label(label) {}
 
-ProgramHeadingNode::ProgramHeadingNode(const std::string& name) :
-    name(name), files(std::make_shared<IdentifierListNode>()) {}
-ProgramHeadingNode::ProgramHeadingNode(const std::string& name, const PNode& files) :
+ProgramHeadingNode::ProgramHeadingNode(Atom name) :
+    name(name), files(make_node<IdentifierListNode>()) {}
+ProgramHeadingNode::ProgramHeadingNode(Atom name, const PNode& files) :
     name(name), files(files) {}
 
 ProgramNode::ProgramNode(const PNode& heading, const PNode& block) :
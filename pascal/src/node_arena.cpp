@@ -0,0 +1,59 @@
+#include "node_arena.h"
+#include "node.h"
+
+#include <algorithm>
+
+const size_t NodeArena::BLOCK;
+const size_t NodeArena::MAX_BLOCK;
+
+thread_local NodeArena* NodeArena::current_ = nullptr;
+
+NodeArena::NodeArena() : next(nullptr), left(0), bytes_(0) {}
+
+NodeArena::~NodeArena() {
+    // nodes don't own each other, so none of them destroys another one
+    for (auto node = nodes.rbegin(); node != nodes.rend(); ++node)
+        if (*node != nullptr)
+            (*node) -> ~Node();
+}
+
+std::shared_ptr<NodeArena> NodeArena::make() {
+    return std::shared_ptr<NodeArena>(new NodeArena);
+}
+
+void* NodeArena::allocate(size_t size, size_t alignment) {
+    size_t padding = (alignment - reinterpret_cast<size_t>(next) % alignment) % alignment;
+    if (next == nullptr || padding + size > left) {
+        size_t block = std::min(BLOCK << std::min<size_t>(blocks.size(), 6), MAX_BLOCK);
+        block = std::max(block, size + alignof(std::max_align_t));
+        blocks.emplace_back(new char[block]);
+        next = blocks.back().get();
+        left = block;
+        padding = (alignment - reinterpret_cast<size_t>(next) % alignment) % alignment;
+    }
+    void* memory = next + padding;
+    next += padding + size;
+    left -= padding + size;
+    bytes_ += padding + size;
+    return memory;
+}
+
+size_t NodeArena::size() const {
+    return nodes.size();
+}
+
+size_t NodeArena::bytes() const {
+    return bytes_;
+}
+
+NodeArena* NodeArena::current() {
+    return current_;
+}
+
+NodeArena::Scope::Scope(NodeArena* arena) : outer(current_) {
+    current_ = arena;
+}
+
+NodeArena::Scope::~Scope() {
+    current_ = outer;
+}
@@ -0,0 +1,129 @@
+#include "node_list.h"
+#include "node.h"
+
+#include <algorithm>
+#include <new>
+
+const size_t NodeList::INLINE;
+
+NodeList::NodeList() :
+    storage(reinterpret_cast<PNode*>(buffer)), capacity(INLINE),
+    first(storage), last(storage) {}
+
+NodeList::NodeList(const NodeList& other) : NodeList() {
+    reserve(other.size());
+    for (const PNode& node : other)
+        push_back(node);
+}
+
+NodeList::NodeList(NodeList&& other) {
+    take(other);
+}
+
+NodeList& NodeList::operator=(const NodeList& other) {
+    if (this != &other) {
+        NodeList copy(other);
+        *this = std::move(copy);
+    }
+    return *this;
+}
+
+NodeList& NodeList::operator=(NodeList&& other) {
+    if (this != &other) {
+        release();
+        take(other);
+    }
+    return *this;
+}
+
+NodeList::~NodeList() {
+    release();
+}
+
+bool NodeList::is_inline() const {
+    return storage == reinterpret_cast<const PNode*>(buffer);
+}
+
+void NodeList::reallocate(size_t front, size_t back) {
+    size_t count = size();
+    size_t new_capacity = front + count + back;
+    PNode* new_storage = new_capacity <= INLINE && is_inline() ?
+                         storage :
+                         static_cast<PNode*>(::operator new(new_capacity * sizeof(PNode)));
+    // the buffer may be both the source and the target
+    PNode* to = new_storage + front;
+    if (to > first) {
+        for (size_t i = count; i > 0; --i) {
+            new (to + i - 1) PNode(std::move(first[i - 1]));
+            first[i - 1].~PNode();
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            new (to + i) PNode(std::move(first[i]));
+            first[i].~PNode();
+        }
+    }
+    if (new_storage != storage && !is_inline())
+        ::operator delete(storage);
+    storage = new_storage;
+    capacity = new_storage == reinterpret_cast<PNode*>(buffer) ? INLINE : new_capacity;
+    first = to;
+    last = to + count;
+}
+
+void NodeList::release() {
+    clear();
+    if (!is_inline())
+        ::operator delete(storage);
+}
+
+void NodeList::take(NodeList& other) {
+    if (other.is_inline()) {
+        storage = reinterpret_cast<PNode*>(buffer);
+        capacity = INLINE;
+        first = last = storage + (other.first - other.storage);
+        for (PNode* node = other.first; node != other.last; ++node)
+            new (last++) PNode(std::move(*node));
+        other.clear();
+    } else {
+        storage = other.storage;
+        capacity = other.capacity;
+        first = other.first;
+        last = other.last;
+        other.storage = other.first = other.last = reinterpret_cast<PNode*>(other.buffer);
+        other.capacity = INLINE;
+    }
+}
+
+void NodeList::push_back(PNode node) {
+    if (last == storage + capacity) {
+        if (is_inline() && size() < INLINE)
+            reallocate(0, INLINE - size());
+        else
+            reallocate(first - storage, std::max(size(), INLINE));
+    }
+    new (last) PNode(std::move(node));
+    ++last;
+}
+
+void NodeList::push_front(PNode node) {
+    if (first == storage) {
+        if (is_inline() && size() < INLINE)
+            reallocate(INLINE - size(), 0);
+        else
+            reallocate(std::max(size(), INLINE), storage + capacity - last);
+    }
+    new (first - 1) PNode(std::move(node));
+    --first;
+}
+
+void NodeList::reserve(size_t count) {
+    if (size_t(storage + capacity - first) < count)
+        reallocate(first - storage, count - size());
+}
+
+void NodeList::clear() {
+    for (PNode* node = first; node != last; ++node)
+        node -> ~PNode();
+    first = last = storage;
+}
@@ -3,10 +3,10 @@
 //#include "parser.h"
 
 //#include <sstream>
-//#include <forward_list>
 #include <stdexcept>
+#include <algorithm>
 //#include "node.h"
-#include "list_guard.h"
+#include "list_mode.h"
 //#include "syntax_error.h"
 //#include "node_traits.h"
 using namespace grammar;
@@ -15,190 +15,363 @@ using namespace grammar;
 /* Grammar definition */
 PascalGrammar::PascalGrammar() : Grammar<PNode>("(end)") {
 
+    set_case_sensitive(false);
     pascal_grammar::add_literals(*this); 
-    pascal_grammar::add_operators(*this); // initializes opening_bracket, sign_eq
-    pascal_grammar::add_types(*this);     // initializes comma, semicolon, end, range, array, packed
-    pascal_grammar::add_sections(*this);  // initializes colon, var
-    pascal_grammar::add_expressions(*this); // initializes dot
-    pascal_grammar::add_statements(*this);
-    pascal_grammar::add_procedures_and_functions(*this);
+    pascal_grammar::add_operators(*this); // initializes opening_bracket, closing_bracket, sign_eq
+    pascal_grammar::add_types(*this);     // initializes comma, semicolon, end, range, array, packed, of, case_
+    pascal_grammar::add_sections(*this);  // initializes colon, var, type_, const_, label
+    pascal_grammar::add_expressions(*this); // initializes dot, opening_square_bracket, closing_square_bracket
+    pascal_grammar::add_statements(*this);  // initializes begin, then, else_, do_, to, downto, until
+    pascal_grammar::add_procedures_and_functions(*this); // initializes procedure, function
 
+    modes.program_heading.set_lbp(*semicolon, 0)
+                         .set_led(*opening_bracket, 
+        [this](PrattParser<PNode>& p, PNode name) -> PNode {
+            if (!node_traits::has_type<IdentifierNode>(name))
+                error("expected identifier as program name");
+            PNode list = p.parse(0);
+            if (!node_traits::is_list_of<IdentifierNode>(list))
+                error("expected list of identifiers after '('");
+            advance(*closing_bracket, "expected ')' after list of identifiers");
+            return make_node<ProgramHeadingNode>(
+                std::static_pointer_cast<IdentifierNode>(name) -> name, 
+                list);
+        });
+    set_list<IdentifierNode>(modes.program_heading, comma, "identifier");
+
+    get_symbols().lexer(); // compiled now, so that threads only read the dictionary
 }
 
-PNode PascalGrammar::parse(const std::string& program) {
-    static PascalGrammar pg;
-    std::string str = program;
-    {
-        bool lower = true;
-        enum { BRACE_COMMENT, BRACKET_COMMENT, STRING, DEFAULT } state = DEFAULT;
-        for (size_t i = 0; i != str.length(); ++i) {
-            switch (state) {
-                case DEFAULT:
-                    if (str[i] == '\'') lower = false, state = STRING;
-                    if (str[i] == '{') lower = false, state = BRACE_COMMENT;
-                    if (str[i] == '(' && (i + 1) < str.length() && str[i + 1] == '*')
-                        lower = false, state = BRACKET_COMMENT;
-                    break;
-                case STRING:
-                    if (str[i] == '\'') lower = true, state = DEFAULT;
-                    break;
-                case BRACE_COMMENT:
-                    if (str[i] == '}') lower = true, state = DEFAULT;
-                    break;
-                case BRACKET_COMMENT:
-                    if (str[i] == '*' && (i + 1) < str.length() && str[i + 1] == ')')
-                        lower = true, state = DEFAULT;
-                    break;
-            }
-            if (lower) str[i] = tolower(str[i]);
+thread_local PascalGrammar::Session* PascalGrammar::session = nullptr;
+
+PascalGrammar::Session::Session(StringRef program, const SymbolDict<PNode>& symbols,
+                                std::vector<Diagnostic>* diagnostics) :
+    arena(NodeArena::current() ? nullptr : NodeArena::make()),
+    in_arena(arena ? arena.get() : NodeArena::current()),
+    tokens(program, symbols, diagnostics != nullptr), parser(tokens), 
+    outer(session), diagnostics(diagnostics), routines(nullptr) {
+    session = this;
+    if (diagnostics != nullptr) {
+        parser.set_error_handler([](const ParseError& e) {
+            instance().error(e.description(), e.position());
+        });
+    }
+}
+
+PascalGrammar::Session::~Session() {
+    session = outer;
+}
+
+PNode PascalGrammar::Session::own(const PNode& node) const {
+    return arena ? share_node(arena, node) : node;
+}
+
+PrattParser<PNode>& PascalGrammar::parser() const {
+    return session -> parser;
+}
+
+const PascalGrammar& PascalGrammar::instance() {
+    static PascalGrammar pg; // initialization is thread-safe
+    return pg;
+}
+
+const SymbolDict<PNode>& PascalGrammar::dictionary() {
+    return instance().get_symbols();
+}
+
+PNode PascalGrammar::parse(StringRef program, size_t* tokens) {
+    Session current(program, instance().get_symbols());
+    if (tokens != nullptr)
+        *tokens = current.tokens.size();
+    return current.own(parse_program());
+}
+
+void PascalGrammar::nest(std::vector<RoutineSpan>& routines) {
+    // recorded when they end, so an outer routine follows those inside it
+    std::stable_sort(routines.begin(), routines.end(),
+        [](const RoutineSpan& a, const RoutineSpan& b) { return a.begin < b.begin; });
+    std::vector<size_t> ends; // of the routines enclosing the current one
+    for (size_t i = 0; i < routines.size(); ++i) {
+        while (!ends.empty() && ends.back() <= routines[i].begin)
+            ends.pop_back();
+        routines[i].depth = ends.size();
+        ends.push_back(routines[i].end);
+    }
+}
+
+ParseResult PascalGrammar::parse_with_recovery(StringRef program, size_t* tokens) {
+    const PascalGrammar& pg = instance();
+    ParseResult result;
+    Session current(program, pg.get_symbols(), &result.diagnostics);
+    if (tokens != nullptr)
+        *tokens = current.tokens.size();
+
+    const std::vector<uint32_t>& invalid = current.tokens.invalid();
+    for (size_t i = 0; i < invalid.size(); ++i)
+        result.diagnostics.push_back(
+            Diagnostic{current.parser.position_of(invalid[i]), "invalid symbol"});
+
+    result.ast = current.own(pg.recover(parse_program));
+    std::stable_sort(result.diagnostics.begin(), result.diagnostics.end(),
+        [](const Diagnostic& a, const Diagnostic& b) {
+            return a.position.position < b.position.position;
+        });
+    return result;
+}
+
+/* A block followed by ';' is the body of a routine whose heading was 
+   skipped after an error, and the block of the program comes after it */
+static PNode join_blocks(const PNode& first, const PNode& second) {
+    auto routine = std::static_pointer_cast<BlockNode>(first);
+    auto program = std::static_pointer_cast<BlockNode>(second);
+    auto& head = std::static_pointer_cast<DeclarationListNode>(routine -> declarations) -> list();
+    auto& tail = std::static_pointer_cast<DeclarationListNode>(program -> declarations) -> list();
+
+    DeclarationListNode::ListT declarations(std::move(head));
+    declarations.reserve(declarations.size() + 1 + tail.size());
+    declarations.push_back(make_node<ProcedureNode>(
+                make_node<ErrorNode>("routine without heading"),
+                make_node<BlockNode>(make_node<DeclarationListNode>(),
+                                     routine -> statements)));
+    for (auto it = tail.begin(); it != tail.end(); ++it)
+        declarations.push_back(std::move(*it));
+    return make_node<BlockNode>(
+            make_node<DeclarationListNode>(std::move(declarations)),
+            program -> statements);
+}
+
+struct PascalGrammar::BlockParser {
+    const PascalGrammar& pg;
+
+    BlockParser() : pg(instance()) {}
+
+    PNode next_symbol() {
+        if (!pg.parser().nud_of(pg.parser().next_token().symbol())) {
+            pg.error(std::string("unexpected symbol: ")
+                   + pg.parser().next_token_as_string());
         }
+        return pg.parser().parse(1); // because of keywords
     }
-    pg.parser = std::unique_ptr<PrattParser<PNode>>(
-                    new PrattParser<PNode>( str, pg.get_symbols() )
-                );
-
-    static struct {
-        PNode operator()() {
-            static auto next_symbol = [&pg]() -> PNode {
-                if (!pg.parser -> next_token().symbol().nud) {
-                    pg.error(std::string("unexpected symbol: ")
-                           + pg.parser -> next_token_as_string());
-                }
-                return pg.parser -> parse(1); // because of keywords
-            };
-
-
-            std::forward_list<PNode> declarations;
-            PNode node;
-            while (true) {
-                if (pg.parser -> next_token_as_string() == "" ||
-                    pg.parser -> next_token_as_string() == ".") 
-                {
-                    pg.error("expected statement part");
-                }
-                node = next_symbol();
-                if (node_traits::has_type<ConstSectionNode>(node)    ||
-                    node_traits::has_type<VariableSectionNode>(node) ||
-                    node_traits::has_type<TypeSectionNode>(node)     ||
-                    node_traits::has_type<LabelSectionNode>(node))
-                {
-                    declarations.push_front(node);
-                } 
-                else if (node_traits::has_type<ProcedureHeadingNode>(node))
-                {
-                    pg.advance(";", "expected ';' after procedure heading");
-                    auto next = pg.parser -> next_token_as_string();
-                    if (next == "forward") {
-                            declarations.push_front(
-                                    std::make_shared<ProcedureForwardDeclNode>(node));
-                            pg.parser -> advance();
+
+    /* Remembers the routine \a node which begins at \a begin 
+       if the session records routines; the next token is the ';' after it */
+    void record(size_t begin, const PNode& node) {
+        if (session -> routines != nullptr && pg.parser().next_is(*(pg.semicolon))) {
+            const Token<PNode>& semicolon = pg.parser().next_token();
+            session -> routines -> push_back(RoutineSpan{
+                begin, semicolon.start_position + semicolon.length, 0, node});
+        }
+    }
+
+    /* Parses a declaration, or the statement part which ends the block */
+    PNode declaration() {
+        if (pg.parser().next_is(pg.get_symbols().end_symbol()) ||
+            pg.parser().next_is(*(pg.dot))) 
+        {
+            return pg.error("expected statement part");
+        }
+        size_t begin = pg.parser().next_token().start_position;
+        // a broken heading is recovered, so that the body isn't taken for the statement part
+        bool routine = pg.parser().next_is(*(pg.procedure)) || 
+                       pg.parser().next_is(*(pg.function));
+        PNode node = routine ? pg.recover([this]() { return next_symbol(); }) 
+                             : next_symbol();
+        if (node_traits::has_type<ConstSectionNode>(node)    ||
+            node_traits::has_type<VariableSectionNode>(node) ||
+            node_traits::has_type<TypeSectionNode>(node)     ||
+            node_traits::has_type<LabelSectionNode>(node))
+        {
+            return node;
+        } 
+        else if (node_traits::has_type<ProcedureHeadingNode>(node) ||
+                 node_traits::has_type<ErrorNode>(node))
+        {
+            pg.advance(*(pg.semicolon), "expected ';' after procedure heading");
+            if (pg.parser().next_text_is("forward")) {
+                    node = make_node<ProcedureForwardDeclNode>(node);
+                    pg.parser().advance();
 #ifdef PASCAL_6000
-                    } else if (next == "extern") {
-                            declarations.push_front(
-                                    std::make_shared<ProcedureExternDeclNode>(node));
-                            pg.parser -> advance();
+            } else if (pg.parser().next_text_is("extern")) {
+                    node = make_node<ProcedureExternDeclNode>(node);
+                    pg.parser().advance();
 #endif
-                    } else {
-                        declarations.push_front(std::make_shared<ProcedureNode>(node, operator()()));
-                    }
-                    pg.advance(";", "expected ';' after procedure declaration");
-                } 
-                else if (node_traits::has_type<FunctionHeadingNode>(node))
-                {    
-                    pg.advance(";", "expected ';' after function heading");
-                    auto next = pg.parser -> next_token_as_string();
-                    if (next == "forward") {
-                            declarations.push_front(
-                                    std::make_shared<FunctionForwardDeclNode>(node));
-                            pg.parser -> advance();
+            } else {
+                node = make_node<ProcedureNode>(node, operator()());
+                record(begin, node);
+            }
+            pg.advance(*(pg.semicolon), "expected ';' after procedure declaration");
+            return node;
+        } 
+        else if (node_traits::has_type<FunctionHeadingNode>(node))
+        {    
+            pg.advance(*(pg.semicolon), "expected ';' after function heading");
+            if (pg.parser().next_text_is("forward")) {
+                    node = make_node<FunctionForwardDeclNode>(node);
+                    pg.parser().advance();
 #ifdef PASCAL_6000
-                    } else if (next == "extern") {
-                            declarations.push_front(
-                                    std::make_shared<FunctionExternDeclNode>(node));
-                            pg.parser -> advance();
+            } else if (pg.parser().next_text_is("extern")) {
+                    node = make_node<FunctionExternDeclNode>(node);
+                    pg.parser().advance();
 #endif
-                    } else {
-                        declarations.push_front(std::make_shared<FunctionNode>(node, operator()()));
-                    }
-                    pg.advance(";", "expected ';' after function declaration");
-                } 
-                else if (node_traits::has_type<FunctionIdentificationNode>(node))
-                {
-                    pg.advance(";", "expected ';' after function identifier");
-                    declarations.push_front(std::make_shared<FunctionNode>(node, operator()()));
-                    pg.advance(";", "expected ';' after function declaration");
-                } 
-                else if (node_traits::has_type<CompoundStatementNode>(node)) {
-                    declarations.push_front(
-                            std::static_pointer_cast<CompoundStatementNode>(node) -> child);
-                    break;
-                } 
-                else {
-                    break;
-                }
-            } // while
-
-            if (declarations.empty())
-                pg.error("expected statement part");
-
-            auto statements = declarations.front();
-            declarations.pop_front();
+            } else {
+                node = make_node<FunctionNode>(node, operator()());
+                record(begin, node);
+            }
+            pg.advance(*(pg.semicolon), "expected ';' after function declaration");
+            return node;
+        } 
+        else if (node_traits::has_type<FunctionIdentificationNode>(node))
+        {
+            pg.advance(*(pg.semicolon), "expected ';' after function identifier");
+            node = make_node<FunctionNode>(node, operator()());
+            record(begin, node);
+            pg.advance(*(pg.semicolon), "expected ';' after function declaration");
+            return node;
+        } 
+        else if (node_traits::has_type<CompoundStatementNode>(node)) {
+            PNode statements = std::static_pointer_cast<CompoundStatementNode>(node) -> child;
             if (!node_traits::is_list_of<StatementNode>(statements))
-                pg.error("expected statement part");
+                return pg.error("expected statement part");
+            return statements;
+        } 
+        return pg.error("expected statement part");
+    }
 
-            declarations.reverse();
-            return std::make_shared<BlockNode>(
-                    std::make_shared<DeclarationListNode>(std::move(declarations)),
-                    std::move(statements));
+    PNode operator()() {
+        NodeList declarations;
+        PNode statements;
+        while (!statements) {
+            PNode node = pg.recover([this]() { return declaration(); });
+            if (node_traits::has_type<ErrorNode>(node)) {
+                // the statement part is missing, or the block began after an error
+                if (pg.parser().stopped() ||
+                    pg.parser().next_is(pg.get_symbols().end_symbol()) ||
+                    pg.parser().next_is(*(pg.dot)))
+                    statements = node;
+                else
+                    declarations.push_back(node);
+            } else if (node_traits::is_list_of<StatementNode>(node)) {
+                statements = node;
+            } else {
+                declarations.push_back(node);
+            }
         }
-    } parse_block;
+
+        return make_node<BlockNode>(
+                make_node<DeclarationListNode>(std::move(declarations)),
+                std::move(statements));
+    }
+};
+
+PNode PascalGrammar::parse_program() {
+    const PascalGrammar& pg = instance();
+    BlockParser parse_block;
 
     PNode block;
-    PNode program_heading = std::make_shared<EmptyNode>();
+    PNode program_heading = make_node<EmptyNode>();
 
     try {
-        if (pg.parser -> next_token_as_string() == "program") {
-            pg.parser -> advance();
-
-            PascalGrammar::lbp_guard semi_guard(*(pg.semicolon), 0);
-            PascalGrammar::list_guard<IdentifierNode> comma_guard(pg, pg.comma, "identifier");
-            PascalGrammar::led_guard open_bracket_guard(*(pg.opening_bracket),
-                [&pg](PrattParser<PNode>& p, PNode name) -> PNode {
-                    if (!node_traits::has_type<IdentifierNode>(name))
-                        pg.error("expected identifier as program name");
-                    PNode list = p.parse(0);
-                    if (!node_traits::is_list_of<IdentifierNode>(list))
-                        pg.error("expected list of identifiers after '('");
-                    pg.advance(")", "expected ')' after list of identifiers");
-                    return std::make_shared<ProgramHeadingNode>(
-                        std::static_pointer_cast<IdentifierNode>(name) -> name, 
-                        list);
-                });
-            program_heading = pg.parser -> parse(0);
-            if (!node_traits::is_convertible_to<ProgramHeadingNode>(program_heading))
-                pg.error("expected program heading");
-            if (node_traits::has_type<IdentifierNode>(program_heading))
-                program_heading = std::make_shared<ProgramHeadingNode>(
-                    std::static_pointer_cast<IdentifierNode>(program_heading) -> name);
-            pg.advance(";", "expected ';' after program heading");
+        pg.check_literals();
+        if (pg.parser().next_text_is("program")) {
+            pg.parser().advance();
+
+            program_heading = pg.recover([&pg]() -> PNode {
+                PascalGrammar::mode_guard guard(pg.parser(), pg.modes.program_heading);
+                PNode heading = pg.parser().parse(0);
+                if (!node_traits::is_convertible_to<ProgramHeadingNode>(heading))
+                    pg.error("expected program heading");
+                if (node_traits::has_type<IdentifierNode>(heading))
+                    heading = make_node<ProgramHeadingNode>(
+                        std::static_pointer_cast<IdentifierNode>(heading) -> name);
+                pg.advance(*(pg.semicolon), "expected ';' after program heading");
+                return heading;
+            });
         }
 
         block = parse_block();
-        pg.advance(".", "expected '.' after 'end'");
-        pg.advance("", "unexpected symbol after 'end.'");
+        while (pg.collects_errors() && pg.parser().next_is(*(pg.semicolon))) {
+            pg.parser().advance();
+            block = join_blocks(block, parse_block());
+        }
+        pg.recover([&pg]() -> PNode {
+            pg.advance(*(pg.dot), "expected '.' after 'end'");
+            pg.advance(pg.get_symbols().end_symbol(), "unexpected symbol after 'end.'");
+            return PNode();
+        });
+    } catch (ParseError& e) {
+        pg.error(e.description(), e.position());
     } catch (std::runtime_error& e) {
         pg.error(e.what());
     }
-    return std::make_shared<ProgramNode>(program_heading, block);
+    return make_node<ProgramNode>(program_heading, block);
+}
+
+PNode PascalGrammar::parse(StringRef program, std::vector<RoutineSpan>& routines) {
+    Session current(program, instance().get_symbols());
+    current.routines = &routines;
+    PNode ast = parse_program();
+    nest(routines);
+    for (size_t i = 0; i < routines.size(); ++i)
+        routines[i].node = current.own(routines[i].node);
+    return current.own(ast);
+}
+
+PNode PascalGrammar::parse_routine(StringRef text, std::vector<RoutineSpan>& routines) {
+    const PascalGrammar& pg = instance();
+    Session current(text, pg.get_symbols());
+    current.routines = &routines;
+    PNode node;
+    try {
+        pg.check_literals();
+        BlockParser blocks;
+        node = blocks.declaration();
+        pg.advance(pg.get_symbols().end_symbol(), "expected a single declaration");
+    } catch (ParseError& e) {
+        pg.error(e.description(), e.position());
+    } catch (std::runtime_error& e) {
+        pg.error(e.what());
+    }
+    nest(routines);
+    if (routines.empty() || routines[0].begin != 0 || routines[0].end != text.size())
+        pg.error("expected procedure or function with a body");
+    for (size_t i = 0; i < routines.size(); ++i)
+        routines[i].node = current.own(routines[i].node);
+    return current.own(node);
+}
+
+void PascalGrammar::check_literals() const {
+    const TokenStream<PNode>& tokens = session -> tokens;
+    for (size_t i = 0; i < tokens.size(); ++i) {
+        if (!tokens.is_literal(i) || !node_traits::has_type<ErrorNode>(tokens.value(i)))
+            continue;
+        const std::string& message = static_cast<const ErrorNode&>(*tokens.value(i)).message;
+        if (collects_errors())
+            report(message, tokens.start(i));
+        else
+            error(message, tokens.start(i));
+    }
 }
 
-void PascalGrammar::error(const std::string& description) const {
-    SourcePosition position = parser -> current_position();
-    const std::string& str = parser -> code();
+PNode PascalGrammar::error(const std::string& description) const {
+    return error(description, parser().next_token().start_position);
+}
+
+PNode PascalGrammar::error(const std::string& description, size_t offset) const {
+    if (session -> diagnostics != nullptr) {
+        PrattParser<PNode>& p = parser();
+        if (!p.stopped()) {
+            report(description, offset);
+            p.stop(make_node<ErrorNode>(description));
+        }
+        return p.stop_value();
+    }
+    const PrattParser<PNode>& parser = session -> parser;
+    SourcePosition position = parser.position_of(offset);
+    StringRef str = parser.code();
     std::stringstream error_desc;
     static const size_t SNIPPET_LEN = 30;
     error_desc << "syntax error near line " << position.line << ": "
-                                            << description;
+                                            << description << unclosed(position);
     error_desc << "\n\t" << "...";
     error_desc << str.substr(position.position > SNIPPET_LEN ? 
                              position.position - SNIPPET_LEN : 
@@ -207,8 +380,51 @@ void PascalGrammar::error(const std::string& description) const {
     throw SyntaxError(error_desc.str());
 }
 
-void PascalGrammar::advance(const std::string& expected, const std::string& desc) {
-    if (parser -> next_token_as_string() != expected)
+void PascalGrammar::advance(const Symbol<PNode>& expected, const std::string& desc) const {
+    if (!parser().next_is(expected))
         error(desc);
-    parser -> advance();
+    parser().advance();
+}
+
+std::string PascalGrammar::unclosed(const SourcePosition& position) const {
+    const StructuralIndex& index = session -> tokens.white_space().index;
+    size_t open = index.unterminated();
+    if (open == std::string::npos || open > position.position)
+        return std::string();
+    std::stringstream note;
+    note << " (" << (index.in_comment(open) ? "comment" : "string")
+         << " starting on line " << parser().position_of(open).line
+         << " is not closed)";
+    return note.str();
+}
+
+bool PascalGrammar::collects_errors() const {
+    return session -> diagnostics != nullptr;
+}
+
+void PascalGrammar::report(const std::string& description) const {
+    report(description, parser().next_token().start_position);
+}
+
+void PascalGrammar::report(const std::string& description, size_t offset) const {
+    std::vector<Diagnostic>& diagnostics = *(session -> diagnostics);
+    SourcePosition position = parser().position_of(offset);
+    if (!diagnostics.empty() && diagnostics.back().position.position == position.position)
+        return; // follows from the error reported here already
+    diagnostics.push_back(Diagnostic{position, description + unclosed(position)});
+}
+
+PNode PascalGrammar::resync(size_t start) const {
+    PrattParser<PNode>& p = parser();
+    const Symbol<PNode>& end_of_program = get_symbols().end_symbol();
+    if (p.next_token().start_position == start && !p.next_is(end_of_program))
+        p.advance(); // otherwise the caller would fail at the same token again
+    while (!(p.next_is(*semicolon) || p.next_is(*end) || p.next_is(*begin) ||
+             p.next_is(*var) || p.next_is(*type_) || p.next_is(*const_) ||
+             p.next_is(*label) || p.next_is(*procedure) || p.next_is(*function) ||
+             p.next_is(end_of_program)))
+    {
+        p.advance();
+    }
+    return make_node<ErrorNode>(session -> diagnostics -> back().message);
 }
@@ -1,43 +1,225 @@
 #include <string>
 #include <sstream>
+#include <limits>
+#include <cstdlib>
+#include <cstdio>
+#include <cmath>
+#include <clocale>
 
 #include "pascal_literals.h"
+#include "simd_scan.h"
 
 namespace pascal {
 
-    size_t number_scanner(const std::string& str, size_t pos) {
+    const char number_first_chars[] = "0123456789";
+    const char string_first_chars[] = "'";
+    const char identifier_first_chars[] = "_abcdefghijklmnopqrstuvwxyz"
+                                           "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+    size_t number_scanner(StringRef str, size_t pos) {
+        const char* s = str.data();
+        size_t len = str.length();
         size_t i = pos;
-        if (i >= str.length() || !isdigit(str[i])) return pos;
-        while (i < str.length() && isdigit(str[i])) 
-            ++i; // reading digits before dot
+        if (i >= len || !simd::is_digit(s[i])) return pos;
+        i = simd::skip_digits(s, i + 1, len); // reading digits before dot
 #ifdef PASCAL_6000
-        if (i < str.length() && str[i] == 'b') { // octal numbers
+        if (i < len && (s[i] == 'b' || s[i] == 'B')) { // octal numbers
             return ++i;
         }
 #endif
-        if (i < str.length() && str[i] == '.') { // if dot is presented
+        if (i < len && s[i] == '.') { // if dot is presented
             ++i;
-            if (i >= str.length() || !isdigit(str[i])) return i - 1;
-            while (i < str.length() && isdigit(str[i]))
-                ++i; // read digits after dot
+            if (i >= len || !simd::is_digit(s[i])) return i - 1;
+            i = simd::skip_digits(s, i + 1, len); // read digits after dot
         }
-        if (i < str.length() && str[i] == 'e') {
+        if (i < len && (s[i] == 'e' || s[i] == 'E')) {
             ++i; // read optional exponent
-            if (i >= str.length()) return pos;
-            if (str[i] == '+' || str[i] == '-')
-                ++i;
-            if (i >= str.length() || !isdigit(str[i])) return pos;
-            while (i < str.length() && isdigit(str[i]))
+            if (i >= len) return pos;
+            if (s[i] == '+' || s[i] == '-')
                 ++i;
+            if (i >= len || !simd::is_digit(s[i])) return pos;
+            i = simd::skip_digits(s, i + 1, len);
         }
         return i;
     }
 
-    std::string number_parser(const std::string& str, size_t beg, size_t end) {
-        return str.substr(beg, end - beg);
+    namespace {
+
+        const uint64_t MAX_UINT64 = std::numeric_limits<uint64_t>::max();
+        const char* const TOO_LARGE = "integer literal doesn't fit into 64 bits";
+
+        /* decimal integers of up to 19 digits can't overflow, 
+           the only check needed is for the 20th digit */
+        uint64_t decode_decimal(const char* s, size_t len, const char*& error) {
+            while (len > 1 && *s == '0') {
+                ++s;
+                --len;
+            }
+            if (len > 20) {
+                error = TOO_LARGE;
+                return MAX_UINT64;
+            }
+            uint64_t v = 0;
+            size_t fast = len < 19 ? len : 19;
+            for (size_t i = 0; i < fast; ++i)
+                v = v * 10 + (s[i] - '0');
+            if (len == 20) {
+                unsigned d = s[19] - '0';
+                if (v > (MAX_UINT64 - d) / 10) {
+                    error = TOO_LARGE;
+                    return MAX_UINT64;
+                }
+                v = v * 10 + d;
+            }
+            return v;
+        }
+
+#ifdef PASCAL_6000
+        uint64_t decode_octal(const char* s, size_t len, const char*& error) {
+            while (len > 1 && *s == '0') {
+                ++s;
+                --len;
+            }
+            for (size_t i = 0; i < len; ++i) {
+                if (s[i] > '7') {
+                    error = "octal literal has digits 8 or 9";
+                    return MAX_UINT64;
+                }
+            }
+            if (len > 22 || (len == 22 && *s > '1')) {
+                error = TOO_LARGE;
+                return MAX_UINT64;
+            }
+            uint64_t v = 0;
+            for (size_t i = 0; i < len; ++i)
+                v = (v << 3) | (s[i] - '0');
+            return v;
+        }
+#endif
+
+        /* std::strtod reads the decimal point of the C locale set by 
+           the program, which may be a comma, so the point of the literal 
+           is replaced with it in the copy */
+        double read_real(const char* s, size_t len) {
+            std::string copy(s, len);
+            const char* point = std::localeconv() -> decimal_point;
+            if (point[0] != '.' || point[1] != '\0') {
+                size_t i = copy.find('.');
+                if (i != std::string::npos)
+                    copy.replace(i, 1, point);
+            }
+            return std::strtod(copy.c_str(), nullptr);
+        }
+
+        /* powers of ten which are exact in double */
+        const double exact_powers_of_ten[] = {
+            1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+
+        /* If the decimal significand fits into 53 bits and the power 
+           of ten is exact, one multiplication or division gives 
+           the correctly rounded result (Clinger's fast path); that covers 
+           nearly all literals written by people and generators. 
+           The rest is left to strtod, which is also correctly rounded
+           but needs a terminated copy, see read_real. */
+        double decode_real(const char* s, size_t len) {
+            uint64_t significand = 0;
+            int digits = 0;   // significant digits in significand
+            int exponent = 0; // decimal exponent of significand
+            bool truncated = false;
+            size_t i = 0;
+            for ( ; i < len && simd::is_digit(s[i]); ++i) {
+                if (digits < 19) {
+                    significand = significand * 10 + (s[i] - '0');
+                    digits += significand != 0;
+                } else {
+                    ++exponent;
+                    truncated |= s[i] != '0';
+                }
+            }
+            if (i < len && s[i] == '.') {
+                for (++i; i < len && simd::is_digit(s[i]); ++i) {
+                    if (digits < 19) {
+                        significand = significand * 10 + (s[i] - '0');
+                        digits += significand != 0;
+                        --exponent;
+                    } else {
+                        truncated |= s[i] != '0';
+                    }
+                }
+            }
+            if (i < len) { // 'e' or 'E'
+                bool negative = false;
+                if (s[++i] == '+' || s[i] == '-')
+                    negative = s[i++] == '-';
+                int e = 0;
+                for ( ; i < len; ++i) {
+                    if (e < 100000) // far beyond the range of double
+                        e = e * 10 + (s[i] - '0');
+                }
+                exponent += negative ? -e : e;
+            }
+
+            if (!truncated && significand <= (uint64_t(1) << 53) &&
+                    exponent >= -22 && exponent <= 22) {
+                double d = static_cast<double>(significand);
+                return exponent >= 0 ? d * exact_powers_of_ten[exponent] 
+                                     : d / exact_powers_of_ten[-exponent];
+            }
+            return read_real(s, len);
+        }
+    }
+
+    Number decode_number(StringRef str, size_t beg, size_t end) {
+        const char* s = str.data();
+        Number n = { false, nullptr, 0, 0.0 };
+        size_t digits_end = simd::skip_digits(s, beg, end);
+#ifdef PASCAL_6000
+        if (digits_end < end && (s[digits_end] == 'b' || s[digits_end] == 'B')) {
+            n.integer = decode_octal(s + beg, digits_end - beg, n.error);
+            return n;
+        }
+#endif
+        if (digits_end == end) {
+            n.integer = decode_decimal(s + beg, end - beg, n.error);
+            return n;
+        }
+        n.is_real = true;
+        n.real = decode_real(s + beg, end - beg);
+        if (std::isinf(n.real))
+            n.error = "real literal is out of range";
+        return n;
+    }
+
+    /* Tries 1 to 17 significant digits, which are always enough; 
+       the result of printf is read independently of the locale, 
+       and read back by decode_real */
+    void format_real(double value, std::string& significand, int& exponent) {
+        exponent = 0;
+        if (!std::isfinite(value)) {
+            significand = std::isinf(value) ? "inf" : "nan";
+            return;
+        }
+        char printed[32];
+        for (int digits = 1; ; ++digits) {
+            std::snprintf(printed, sizeof(printed), "%.*e", digits - 1, value);
+            std::string number;
+            const char* p = printed;
+            for ( ; *p != 'e'; ++p) {
+                if (simd::is_digit(*p))
+                    number += *p;
+            }
+            exponent = std::atoi(p + 1);
+            significand = number.substr(0, 1) + '.' + 
+                          (number.size() > 1 ? number.substr(1) : "0");
+            std::string literal = significand + 'e' + std::to_string(exponent);
+            if (digits == 17 || decode_real(literal.data(), literal.size()) == value)
+                return;
+        }
     }
 
-    size_t string_scanner(const std::string& str, size_t pos) {
+    size_t string_scanner(StringRef str, size_t pos) {
         size_t i = pos;
         for ( ; ; ) {
             if (i >= str.length() || str[i] != '\'') return i;
@@ -49,7 +231,7 @@ namespace pascal {
         }
     }
 
-    std::string string_parser(const std::string& str, size_t beg, size_t end) {
+    std::string string_parser(StringRef str, size_t beg, size_t end) {
         std::stringstream sstr;
         for (size_t pos = beg + 1; pos < end - 1; ++pos) {
             if (str[pos] != '\'') sstr << str[pos];
@@ -62,18 +244,13 @@ namespace pascal {
     }
 
     /* scans [_\w][_\w\d]+ */
-    size_t identifier_scanner(const std::string& str, size_t pos) {
-        size_t i = pos;
-        if (i < str.length() && (isalpha(str[i]) || str[i] == '_'))
-            ++i;
-        else
-            return pos; 
-        while (i < str.length() && (isalnum(str[i]) || str[i] == '_'))
-            ++i;
-        return i;
+    size_t identifier_scanner(StringRef str, size_t pos) {
+        if (pos >= str.length() || !simd::is_word_start(str[pos]))
+            return pos;
+        return simd::skip_word(str.data(), pos + 1, str.length());
     }
 
-    std::string identifier_parser(const std::string& str, size_t beg, size_t end) {
-        return str.substr(beg, end - beg);
+    std::string identifier_parser(StringRef str, size_t beg, size_t end) {
+        return str.substr(beg, end - beg).str();
     }
 }
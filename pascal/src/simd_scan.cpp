@@ -0,0 +1,267 @@
+#include "simd_scan.h"
+
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define SIMD_SCAN_X86
+#include <immintrin.h>
+#endif
+
+namespace simd {
+
+#define D DIGIT
+#define A ALPHA
+    const unsigned char char_classes[256] = {
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x00
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x10
+        0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, // 0x20
+        D, D, D, D, D, D, D, D, D, D, 0, 0, 0, 0, 0, 0, // 0x30
+        0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, // 0x40
+        A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, UNDERSCORE, // 0x50
+        0, A, A, A, A, A, A, A, A, A, A, A, A, A, A, A, // 0x60
+        A, A, A, A, A, A, A, A, A, A, A, 0, 0, 0, 0, 0, // 0x70
+        /* the rest is zero */
+    };
+#undef D
+#undef A
+
+    namespace scalar {
+
+        size_t skip_digits(const char* s, size_t pos, size_t len) {
+            while (pos < len && is_digit(s[pos]))
+                ++pos;
+            return pos;
+        }
+
+        size_t skip_word(const char* s, size_t pos, size_t len) {
+            while (pos < len && is_word(s[pos]))
+                ++pos;
+            return pos;
+        }
+
+        void classify(const char* s, BlockMasks& m) {
+            BlockMasks r = { 0, 0, 0, 0, 0, 0, 0 };
+            for (unsigned i = 0; i < 64; ++i) {
+                uint64_t bit = uint64_t(1) << i;
+                switch (s[i]) {
+                    case '\'': r.quote |= bit; break;
+                    case '{': r.open_brace |= bit; break;
+                    case '}': r.close_brace |= bit; break;
+                    case '(': r.open_paren |= bit; break;
+                    case '*': r.star |= bit; break;
+                    case ')': r.close_paren |= bit; break;
+                }
+                if (is_space(s[i]))
+                    r.space |= bit;
+            }
+            m = r;
+        }
+    }
+
+#ifdef SIMD_SCAN_X86
+    namespace {
+
+        /*
+         * digits are checked as (unsigned)(c - '0') <= 9,
+         * letters as (unsigned)((c | 0x20) - 'a') <= 25
+         */
+
+        __attribute__((target("sse2")))
+        size_t skip_digits_sse2(const char* s, size_t pos, size_t len) {
+            const __m128i zero = _mm_set1_epi8('0');
+            const __m128i nine = _mm_set1_epi8(9);
+            for ( ; pos + 16 <= len; pos += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + pos));
+                __m128i d = _mm_sub_epi8(v, zero);
+                __m128i digits = _mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine);
+                unsigned m = ~static_cast<unsigned>(_mm_movemask_epi8(digits)) & 0xFFFFu;
+                if (m != 0)
+                    return pos + __builtin_ctz(m);
+            }
+            return scalar::skip_digits(s, pos, len);
+        }
+
+        __attribute__((target("sse2")))
+        size_t skip_word_sse2(const char* s, size_t pos, size_t len) {
+            const __m128i zero = _mm_set1_epi8('0');
+            const __m128i nine = _mm_set1_epi8(9);
+            const __m128i lower = _mm_set1_epi8(0x20);
+            const __m128i a = _mm_set1_epi8('a');
+            const __m128i twenty_five = _mm_set1_epi8(25);
+            const __m128i underscore = _mm_set1_epi8('_');
+            for ( ; pos + 16 <= len; pos += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + pos));
+                __m128i d = _mm_sub_epi8(v, zero);
+                __m128i l = _mm_sub_epi8(_mm_or_si128(v, lower), a);
+                __m128i word = _mm_or_si128(
+                        _mm_or_si128(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine),
+                                     _mm_cmpeq_epi8(_mm_max_epu8(l, twenty_five), twenty_five)),
+                        _mm_cmpeq_epi8(v, underscore));
+                unsigned m = ~static_cast<unsigned>(_mm_movemask_epi8(word)) & 0xFFFFu;
+                if (m != 0)
+                    return pos + __builtin_ctz(m);
+            }
+            return scalar::skip_word(s, pos, len);
+        }
+
+        /*
+         * the AVX2 kernels hand the last < 32 bytes to the SSE2 ones,
+         * whose legacy-encoded instructions stall while the upper halves
+         * of the ymm registers are dirty, so those are cleared first;
+         * on return the compiler clears them itself
+         */
+
+        __attribute__((target("avx2")))
+        size_t skip_digits_avx2(const char* s, size_t pos, size_t len) {
+            const __m256i zero = _mm256_set1_epi8('0');
+            const __m256i nine = _mm256_set1_epi8(9);
+            for ( ; pos + 32 <= len; pos += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + pos));
+                __m256i d = _mm256_sub_epi8(v, zero);
+                __m256i digits = _mm256_cmpeq_epi8(_mm256_max_epu8(d, nine), nine);
+                unsigned m = ~static_cast<unsigned>(_mm256_movemask_epi8(digits));
+                if (m != 0)
+                    return pos + __builtin_ctz(m);
+            }
+            _mm256_zeroupper();
+            return skip_digits_sse2(s, pos, len);
+        }
+
+        __attribute__((target("avx2")))
+        size_t skip_word_avx2(const char* s, size_t pos, size_t len) {
+            const __m256i zero = _mm256_set1_epi8('0');
+            const __m256i nine = _mm256_set1_epi8(9);
+            const __m256i lower = _mm256_set1_epi8(0x20);
+            const __m256i a = _mm256_set1_epi8('a');
+            const __m256i twenty_five = _mm256_set1_epi8(25);
+            const __m256i underscore = _mm256_set1_epi8('_');
+            for ( ; pos + 32 <= len; pos += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + pos));
+                __m256i d = _mm256_sub_epi8(v, zero);
+                __m256i l = _mm256_sub_epi8(_mm256_or_si256(v, lower), a);
+                __m256i word = _mm256_or_si256(
+                        _mm256_or_si256(
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(d, nine), nine),
+                            _mm256_cmpeq_epi8(_mm256_max_epu8(l, twenty_five), twenty_five)),
+                        _mm256_cmpeq_epi8(v, underscore));
+                unsigned m = ~static_cast<unsigned>(_mm256_movemask_epi8(word));
+                if (m != 0)
+                    return pos + __builtin_ctz(m);
+            }
+            _mm256_zeroupper();
+            return skip_word_sse2(s, pos, len);
+        }
+
+        /*
+         * white space is ' ' or [\t-\r], the latter is checked as
+         * (unsigned)(c - '\t') <= 4 which is max(c - '\t', 4) == 4
+         */
+
+        __attribute__((target("sse2")))
+        void classify_sse2(const char* s, BlockMasks& m) {
+            const __m128i quote = _mm_set1_epi8('\'');
+            const __m128i open_brace = _mm_set1_epi8('{');
+            const __m128i close_brace = _mm_set1_epi8('}');
+            const __m128i open_paren = _mm_set1_epi8('(');
+            const __m128i star = _mm_set1_epi8('*');
+            const __m128i close_paren = _mm_set1_epi8(')');
+            const __m128i tab = _mm_set1_epi8('\t');
+            const __m128i four = _mm_set1_epi8(4);
+            const __m128i space = _mm_set1_epi8(' ');
+            BlockMasks r = { 0, 0, 0, 0, 0, 0, 0 };
+            for (unsigned i = 0; i < 64; i += 16) {
+                __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i));
+#define MASK(x) (uint64_t(static_cast<unsigned>(_mm_movemask_epi8(x))) << i)
+                r.quote |= MASK(_mm_cmpeq_epi8(v, quote));
+                r.open_brace |= MASK(_mm_cmpeq_epi8(v, open_brace));
+                r.close_brace |= MASK(_mm_cmpeq_epi8(v, close_brace));
+                r.open_paren |= MASK(_mm_cmpeq_epi8(v, open_paren));
+                r.star |= MASK(_mm_cmpeq_epi8(v, star));
+                r.close_paren |= MASK(_mm_cmpeq_epi8(v, close_paren));
+                __m128i ctrl = _mm_sub_epi8(v, tab);
+                r.space |= MASK(_mm_or_si128(_mm_cmpeq_epi8(v, space),
+                                    _mm_cmpeq_epi8(_mm_max_epu8(ctrl, four), four)));
+#undef MASK
+            }
+            m = r;
+        }
+
+        __attribute__((target("avx2")))
+        void classify_avx2(const char* s, BlockMasks& m) {
+            const __m256i quote = _mm256_set1_epi8('\'');
+            const __m256i open_brace = _mm256_set1_epi8('{');
+            const __m256i close_brace = _mm256_set1_epi8('}');
+            const __m256i open_paren = _mm256_set1_epi8('(');
+            const __m256i star = _mm256_set1_epi8('*');
+            const __m256i close_paren = _mm256_set1_epi8(')');
+            const __m256i tab = _mm256_set1_epi8('\t');
+            const __m256i four = _mm256_set1_epi8(4);
+            const __m256i space = _mm256_set1_epi8(' ');
+            BlockMasks r = { 0, 0, 0, 0, 0, 0, 0 };
+            for (unsigned i = 0; i < 64; i += 32) {
+                __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i));
+#define MASK(x) (uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(x))) << i)
+                r.quote |= MASK(_mm256_cmpeq_epi8(v, quote));
+                r.open_brace |= MASK(_mm256_cmpeq_epi8(v, open_brace));
+                r.close_brace |= MASK(_mm256_cmpeq_epi8(v, close_brace));
+                r.open_paren |= MASK(_mm256_cmpeq_epi8(v, open_paren));
+                r.star |= MASK(_mm256_cmpeq_epi8(v, star));
+                r.close_paren |= MASK(_mm256_cmpeq_epi8(v, close_paren));
+                __m256i ctrl = _mm256_sub_epi8(v, tab);
+                r.space |= MASK(_mm256_or_si256(_mm256_cmpeq_epi8(v, space),
+                                    _mm256_cmpeq_epi8(_mm256_max_epu8(ctrl, four), four)));
+#undef MASK
+            }
+            m = r;
+        }
+    }
+#endif
+
+    namespace {
+        struct Kernels {
+            size_t (*skip_digits)(const char*, size_t, size_t);
+            size_t (*skip_word)(const char*, size_t, size_t);
+            void (*classify)(const char*, BlockMasks&);
+        };
+
+        Kernels select_kernels() {
+#ifdef SIMD_SCAN_X86
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx2")) {
+                Kernels k = { skip_digits_avx2, skip_word_avx2, classify_avx2 };
+                return k;
+            }
+            if (__builtin_cpu_supports("sse2")) {
+                Kernels k = { skip_digits_sse2, skip_word_sse2, classify_sse2 };
+                return k;
+            }
+#endif
+            Kernels k = { scalar::skip_digits, scalar::skip_word, scalar::classify };
+            return k;
+        }
+
+        const Kernels& kernels() {
+            static const Kernels k = select_kernels();
+            return k;
+        }
+    }
+
+    size_t skip_digits(const char* s, size_t pos, size_t len) {
+        return kernels().skip_digits(s, pos, len);
+    }
+
+    size_t skip_word(const char* s, size_t pos, size_t len) {
+        return kernels().skip_word(s, pos, len);
+    }
+
+    void classify(const char* s, size_t n, BlockMasks& m) {
+        if (n >= 64) {
+            kernels().classify(s, m);
+            return;
+        }
+        char block[64] = { 0 }; // NUL belongs to none of the classes
+        std::copy(s, s + n, block);
+        kernels().classify(block, m);
+    }
+
+}
@@ -0,0 +1,123 @@
+#include "structural_index.h"
+#include "simd_scan.h"
+
+namespace {
+    /// Bits from \a from to 63, none if \a from >= 64
+    inline uint64_t bits_from(size_t from) {
+        return from >= 64 ? 0 : ~uint64_t(0) << from;
+    }
+
+    /// Bits from \a from to \a to inclusive
+    inline uint64_t bit_range(size_t from, size_t to) {
+        return (~uint64_t(0) >> (63 - to)) & (~uint64_t(0) << from);
+    }
+}
+
+StructuralIndex::StructuralIndex(StringRef text) :
+    length(text.length()), unterminated_(std::string::npos)
+{
+    size_t blocks = (length + 63) / 64;
+    comments.assign(blocks, 0);
+    strings.assign(blocks, 0);
+    skip.assign(blocks, 0);
+
+    enum { DEFAULT, STRING, BRACE_COMMENT, BRACKET_COMMENT } state = DEFAULT;
+    size_t open = 0; // position where the current comment or string begins
+    bool close_pending = false; // ')' of '*)' is the first character of the next block
+
+    const char* s = text.data();
+    simd::BlockMasks m = { 0, 0, 0, 0, 0, 0, 0 }, next = m;
+    if (blocks > 0)
+        simd::classify(s, length, m);
+
+    for (size_t b = 0; b < blocks; ++b) {
+        size_t base = b * 64;
+        if (b + 1 < blocks) {
+            simd::classify(s + base + 64, length - base - 64, next);
+        } else {
+            simd::BlockMasks none = { 0, 0, 0, 0, 0, 0, 0 };
+            next = none;
+        }
+
+        /* two-character delimiters are marked at their first character */
+        uint64_t paren_star = m.open_paren & ((m.star >> 1) | (next.star << 63));
+        uint64_t star_paren = m.star & ((m.close_paren >> 1) | (next.close_paren << 63));
+
+        uint64_t comment = 0, string = 0;
+        size_t i = 0; // characters before i are processed
+        if (close_pending) {
+            comment |= 1;
+            i = 1;
+            close_pending = false;
+        }
+        while (i < 64) {
+            if (state == DEFAULT) {
+                uint64_t openers = (m.quote | m.open_brace | paren_star) & bits_from(i);
+                if (openers == 0)
+                    break;
+                i = __builtin_ctzll(openers);
+                uint64_t bit = uint64_t(1) << i;
+                state = (m.quote & bit) ? STRING : 
+                        (m.open_brace & bit) ? BRACE_COMMENT : BRACKET_COMMENT;
+                open = base + i;
+                continue;
+            }
+
+            /* the region began at i (or in one of the previous blocks); 
+               '(*)' doesn't close the comment it opens */
+            size_t min_close = open + (state == BRACKET_COMMENT ? 2 : 1);
+            uint64_t closers = (state == STRING        ? m.quote :
+                                state == BRACE_COMMENT ? m.close_brace : star_paren)
+                               & bits_from(min_close > base ? min_close - base : 0);
+            uint64_t& region = state == STRING ? string : comment;
+            if (closers == 0) {
+                region |= bits_from(i);
+                break;
+            }
+            size_t last = __builtin_ctzll(closers);
+            if (state == BRACKET_COMMENT) {
+                if (last == 63)
+                    close_pending = true;
+                else
+                    ++last;
+            }
+            region |= bit_range(i, last);
+            i = last + 1;
+            state = DEFAULT;
+        }
+
+        uint64_t valid = (b + 1 < blocks || length % 64 == 0) ? ~uint64_t(0) 
+                                                              : ~bits_from(length % 64);
+        comments[b] = comment & valid;
+        strings[b] = string & valid;
+        skip[b] = ((m.space & ~string) | comment) & valid;
+        m = next;
+    }
+
+    if (state != DEFAULT)
+        unterminated_ = open;
+}
+
+bool StructuralIndex::test(const std::vector<uint64_t>& bitmap, size_t pos) const {
+    return pos < length && ((bitmap[pos / 64] >> (pos % 64)) & 1);
+}
+
+size_t StructuralIndex::next_token_start(size_t pos) const {
+    if (pos >= length)
+        return length;
+    size_t w = pos / 64;
+    uint64_t bits = ~skip[w] & bits_from(pos % 64);
+    while (bits == 0) {
+        if (++w == skip.size())
+            return length;
+        bits = ~skip[w];
+    }
+    size_t start = w * 64 + __builtin_ctzll(bits);
+    return start < length ? start : length;
+}
+
+bool StructuralIndex::in_comment(size_t pos) const { return test(comments, pos); }
+
+bool StructuralIndex::in_string(size_t pos) const { return test(strings, pos); }
+
+size_t StructuralIndex::unterminated() const { return unterminated_; }
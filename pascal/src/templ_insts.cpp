@@ -1,4 +1,5 @@
 #include "parser_impl.h"
+#include "skip_white_space.h"
 
 #include <memory>
 #include <string>
@@ -6,46 +7,36 @@ struct Node;
 
 namespace token {
 
-    /// Specialization to treat {...} and (* ... *) as white space
-    template <>
-    struct SkipWhiteSpace<std::shared_ptr<Node>> {
-        void operator()(const std::string& s, size_t& start, 
-                                              size_t& last_new_line,
-                                              size_t& new_lines) {
-            while (start < s.length()) {
-                if (isspace(s[start])) {
-                    if (s[start] == '\n') last_new_line = start, ++new_lines;
-                    ++start;
-                } else if (s[start] == '{') {
-                    while (start < s.length() && s[start] != '}') {
-                        if (s[start] == '\n') last_new_line = start, ++new_lines;
-                        ++start;
-                    }
-                    ++start; // skip '}'
-                } else if (s[start] == '(' && (start + 1) < s.length() && s[start+1]=='*') {
-                    start += 2;
-                    while (start < s.length() && 
-                            !( s[start] == '*' && (start + 1) < s.length() && s[start + 1] == ')')) {
-                        if (s[start] == '\n') last_new_line = start, ++new_lines;
-                        ++start;
-                    }
-                    start += 2; // skip '*)'
-                } else {
-                    return;
-                }
-            }
-        }
-    };
+    SkipWhiteSpace<std::shared_ptr<Node>>::SkipWhiteSpace(StringRef str) :
+        index(str) {}
+
+    void SkipWhiteSpace<std::shared_ptr<Node>>::operator()(StringRef, 
+                                                           size_t& start) {
+        start = index.next_token_start(start);
+    }
 }
 
 template class Symbol<std::shared_ptr<Node>>;
+template class SymbolDict<std::shared_ptr<Node>>;
 template class Token<std::shared_ptr<Node>>;
+template class TokenStream<std::shared_ptr<Node>>;
+template class TokenDocument<std::shared_ptr<Node>>;
+template class Lexer<std::shared_ptr<Node>>;
 template class PrattParser<std::shared_ptr<Node>>;
 template class grammar::Grammar<std::shared_ptr<Node>>;
 
+template class Mode<std::shared_ptr<Node>>;
+
 #define PG grammar::Grammar<std::shared_ptr<Node>>
-template struct PG::behaviour_guard<PG::Prefix>;
-template struct PG::behaviour_guard<PG::Postfix>;
-template struct PG::behaviour_guard<PG::LeftAssociative>;
-template struct PG::behaviour_guard<PG::RightAssociative>;
+#define SET_BEHAVIOUR(S) \
+template void PG::set_behaviour<PG::S>(Mode<std::shared_ptr<Node>>&, \
+        const Symbol<std::shared_ptr<Node>>&, PG::S::handler_type); \
+template void PG::set_behaviour<PG::S>(Mode<std::shared_ptr<Node>>&, \
+        const Symbol<std::shared_ptr<Node>>&, int, PG::S::handler_type);
+SET_BEHAVIOUR(Prefix)
+SET_BEHAVIOUR(Postfix)
+SET_BEHAVIOUR(LeftAssociative)
+SET_BEHAVIOUR(RightAssociative)
+SET_BEHAVIOUR(List)
+#undef SET_BEHAVIOUR
 #undef PG
@@ -5,24 +5,26 @@
 //#include <string>
 #include <stdexcept>
 #include <iostream>
-#include <fstream>
-#include <streambuf>
+#include <memory>
 using namespace std;
 
 int main(int argc, const char* argv[]) {
     try {
-        string code;
+        string line;
+        unique_ptr<MappedFile> file;
+        StringRef code;
 
         if (argc == 1) {
-            getline(cin, code);
+            getline(cin, line);
+            code = line;
         } else if (argc > 2) {
             cout << "usage: " << argv[0] << " [filename]" << '\n'
                  << "\tif filename is provided, prints its AST" << '\n'
                  << "\totherwise reads a string from stdin\n";
+            return 0;
         } else { // argc == 2
-            ifstream in(argv[1]);
-            code = string(istreambuf_iterator<char>(in),
-                          istreambuf_iterator<char>());
+            file.reset(new MappedFile(argv[1])); // parsed in place, not copied
+            code = file -> text();
         }
 
         PNode node = PascalGrammar::parse(code);
@@ -32,5 +34,7 @@ int main(int argc, const char* argv[]) {
         cout << e.what() << endl;
     } catch (const char* msg) {
         cout << "Error: " << msg << endl;
+    } catch (std::runtime_error& e) {
+        cout << "Error: " << e.what() << endl;
     }
 }
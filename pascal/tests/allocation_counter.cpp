@@ -0,0 +1,84 @@
+#include "allocation_counter.h"
+
+#include <atomic>
+#include <new>
+#include <cstdlib>
+
+/* All forms of the global allocation functions are replaced, so that
+   no pointer is freed by a function other than the one matching the one
+   which allocated it. They are in a file of their own: inlined into 
+   the code which allocates, free() looks to the compiler like 
+   a mismatched deallocation of what operator new returned. */
+
+namespace {
+    std::atomic<size_t> count(0);
+
+    void* allocate(size_t size) noexcept {
+        count.fetch_add(1, std::memory_order_relaxed);
+        return std::malloc(size > 0 ? size : 1);
+    }
+
+#ifdef __cpp_aligned_new
+    void* allocate(size_t size, std::align_val_t alignment) noexcept {
+        count.fetch_add(1, std::memory_order_relaxed);
+        size_t align = static_cast<size_t>(alignment);
+        return std::aligned_alloc(align, (size + align - 1) / align * align);
+    }
+#endif
+}
+
+size_t allocations() {
+    return count.load();
+}
+
+void* operator new(size_t size) {
+    if (void* p = allocate(size))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+#ifdef __cpp_aligned_new
+void* operator new(size_t size, std::align_val_t alignment) {
+    if (void* p = allocate(size, alignment))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate(size, alignment);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { std::free(p); }
+#endif
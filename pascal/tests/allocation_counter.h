@@ -0,0 +1,12 @@
+#ifndef ALLOCATION_COUNTER_H
+#define ALLOCATION_COUNTER_H
+
+#include <cstddef>
+
+/** Number of calls to operator new and new[] made so far by all threads.
+ *  The counting operators replace the global ones in programs linked
+ *  with allocation_counter.cpp.
+ */
+size_t allocations();
+
+#endif
@@ -0,0 +1,429 @@
+#include "test_utils.h"
+#include "allocation_counter.h"
+
+#include "batch_parser.h"
+#include "incremental_parser.h"
+#include "flat_ast.h"
+#include "node.h"
+
+#include <stdexcept>
+#include <iostream>
+#include <memory>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <cstdlib>
+#include <algorithm>
+#include <functional>
+#include <sys/resource.h>
+using namespace std;
+
+static double seconds_since(chrono::steady_clock::time_point start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+/* Lexes the code with Token::iterator and by scanning every symbol
+   of the dictionary at every token and prints how fast each of them is,
+   and how many allocations lexing and parsing make per token */
+static void compare_lexers(StringRef code, unsigned rounds) {
+    vector<LexedToken> tokens;
+    lex_compiled(code, &tokens);
+
+    auto measure = [&](const function<void(StringRef, vector<LexedToken>*)>& lex) {
+        auto start = chrono::steady_clock::now();
+        for (unsigned r = 0; r < rounds; ++r)
+            lex(code, nullptr);
+        return tokens.size() * rounds / seconds_since(start);
+    };
+    double per_symbol = measure(lex_scanning);
+    double trie = measure(lex_compiled);
+
+    size_t before = allocations();
+    lex_compiled(code, nullptr);
+    size_t lexing = allocations() - before;
+    before = allocations();
+    auto start = chrono::steady_clock::now();
+    PascalGrammar::parse(code);
+    double parsing = seconds_since(start);
+    size_t parse = allocations() - before;
+
+    const SymbolDict<PNode>& symbols = PascalGrammar::dictionary();
+    double n = tokens.size();
+    cout << tokens.size() << " tokens, " << distance(symbols.cbegin(), symbols.cend()) << " symbols\n"
+         << "scanning every symbol: " << per_symbol / 1e6 << " Mtok/s\n"
+         << "Token::iterator: " << trie / 1e6 << " Mtok/s, speedup " << trie / per_symbol
+         << ", " << lexing / n << " allocations per token\n"
+         << "parse: " << n / parsing / 1e6 << " Mtok/s, " << parse / n << " allocations per token\n";
+}
+
+/* Parses the same code in 1, 2, 4, ... up to max_threads threads at once,
+   each thread doing the same number of parses, and prints the throughput */
+static void measure_scaling(StringRef code, unsigned max_threads) {
+    const unsigned rounds = 20; // parses per thread
+    PascalGrammar::parse(code); // reports syntax errors before threads are started
+    double single = 0;
+    for (unsigned n = 1; n <= max_threads; n *= 2) {
+        vector<thread> threads;
+        auto start = chrono::steady_clock::now();
+        for (unsigned i = 0; i < n; ++i) {
+            threads.push_back(thread([code]() {
+                for (unsigned r = 0; r < rounds; ++r)
+                    PascalGrammar::parse(code);
+            }));
+        }
+        for (auto& t : threads)
+            t.join();
+        double parses = n * rounds / seconds_since(start);
+        if (n == 1)
+            single = parses;
+        cout << n << " threads: " << parses << " parses/s, "
+             << parses * code.size() / (1 << 20) << " MB/s, speedup "
+             << parses / single << '\n';
+    }
+}
+
+/* Parses the files named on the command line after "--batch [-jN]",
+   or on stdin if there are none, and prints errors and statistics */
+static void parse_batch(int argc, const char* argv[]) {
+    unsigned threads = 0;
+    int first = 2;
+    if (argc > first && string(argv[first]).compare(0, 2, "-j") == 0)
+        threads = atoi(argv[first++] + 2);
+
+    BatchParser batch(threads);
+    if (argc > first) {
+        for (int i = first; i < argc; ++i)
+            batch.add_file(argv[i]);
+    } else {
+        string path;
+        while (getline(cin, path))
+            if (!path.empty())
+                batch.add_file(path);
+    }
+
+    auto start = chrono::steady_clock::now();
+    vector<BatchResult> results = batch.run();
+    double seconds = seconds_since(start);
+
+    size_t bytes = 0, tokens = 0, failed = 0;
+    vector<double> latencies;
+    for (auto& r : results) {
+        if (!r.ast) {
+            ++failed;
+            cout << r.name << ": " << r.error << '\n';
+        }
+        bytes += r.bytes;
+        tokens += r.tokens;
+        latencies.push_back(r.seconds);
+    }
+    if (results.empty())
+        return;
+    sort(latencies.begin(), latencies.end());
+    auto percentile = [&latencies](double p) {
+        return latencies[size_t(p * (latencies.size() - 1))] * 1000;
+    };
+
+    cout << results.size() << " files (" << failed << " with errors) in "
+         << seconds << " s\n"
+         << results.size() / seconds << " files/s, "
+         << bytes / seconds / (1 << 20) << " MB/s, "
+         << tokens / seconds << " tokens/s\n"
+         << "ms per file: p50 " << percentile(0.5) << ", p90 " << percentile(0.9)
+         << ", p99 " << percentile(0.99) << ", max " << latencies.back() * 1000 << '\n';
+
+    results.clear(); // no atom is kept now
+    size_t atoms = Atom::count();
+    Atom::clear();
+    cout << atoms << " atoms freed\n";
+}
+
+/* Measures how fast all syntax errors of the code are collected
+   and how fast a parse stopping at the first one is */
+static void measure_recovery(StringRef code, unsigned rounds) {
+    size_t diagnostics = 0;
+    auto start = chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+        diagnostics += PascalGrammar::parse_with_recovery(code).diagnostics.size();
+    double seconds = seconds_since(start);
+
+    start = chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r) {
+        try {
+            PascalGrammar::parse(code);
+        } catch (SyntaxError&) {}
+    }
+    double first = seconds_since(start);
+
+    cout << diagnostics / rounds << " errors per parse\n"
+         << "recovering: " << rounds / seconds << " parses/s, "
+         << rounds * code.size() / seconds / (1 << 20) << " MB/s\n"
+         << "stopping at the first error: " << rounds / first << " parses/s\n";
+}
+
+/* Generates a program of the given number of routines, breaks every
+   n-th assignment in it by a ')' after ":=", and measures how long
+   collecting the errors takes per error, compared with parsing the
+   program as it was generated */
+static void measure_error_density(unsigned routines, unsigned every) {
+    string text = generate_program(routines, 1);
+    string broken;
+    broken.reserve(text.size() + text.size() / every);
+    size_t copied = 0, assignments = 0;
+    for (size_t pos = text.find(":="); pos != string::npos; pos = text.find(":=", pos + 2)) {
+        if (assignments++ % every != 0)
+            continue;
+        broken.append(text, copied, pos + 2 - copied);
+        broken += " )";
+        copied = pos + 2;
+    }
+    broken.append(text, copied, string::npos);
+
+    const unsigned rounds = 10;
+    auto start = chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+        PascalGrammar::parse_with_recovery(text);
+    double clean = seconds_since(start) / rounds;
+
+    size_t diagnostics = 0;
+    start = chrono::steady_clock::now();
+    for (unsigned r = 0; r < rounds; ++r)
+        diagnostics += PascalGrammar::parse_with_recovery(broken).diagnostics.size();
+    double recovering = seconds_since(start) / rounds;
+    diagnostics /= rounds;
+
+    cout << assignments << " assignments, " << diagnostics << " errors\n"
+         << "without errors: " << clean * 1000 << " ms, with them: "
+         << recovering * 1000 << " ms\n";
+    if (diagnostics > 0)
+        cout << (recovering - clean) / diagnostics * 1e6 << " us per error\n";
+}
+
+/* Makes edits in the code, updating its AST by IncrementalParser,
+   then makes them again parsing the whole code after each edit,
+   and compares the time taken */
+static void edit_incrementally(StringRef code, unsigned count) {
+    string text = code.str();
+
+    // each edit turns "x := e" into "x := 1 + e"; made from the end,
+    // so that positions of the remaining ones don't change
+    vector<size_t> positions;
+    for (size_t pos = text.find(":="); pos != string::npos; pos = text.find(":=", pos + 2))
+        positions.push_back(pos + 2);
+    if (positions.empty())
+        return;
+    vector<TextEdit> edits;
+    for (unsigned i = 0; i < count; ++i) {
+        size_t pos = positions[positions.size() - 1 -
+                               size_t(i) * positions.size() / count % positions.size()];
+        edits.push_back(TextEdit{pos, 0, " 1 +"});
+    }
+
+    vector<double> incremental, full;
+    unsigned local = 0;
+    IncrementalParser parser(text);
+    for (auto& edit : edits) {
+        auto start = chrono::steady_clock::now();
+        local += parser.edit(edit);
+        incremental.push_back(seconds_since(start));
+    }
+    for (auto& edit : edits) {
+        text.replace(edit.offset, edit.removed, edit.inserted);
+        auto start = chrono::steady_clock::now();
+        PascalGrammar::parse(text);
+        full.push_back(seconds_since(start));
+    }
+
+    sort(incremental.begin(), incremental.end());
+    sort(full.begin(), full.end());
+    cout << count << " edits, " << local << " reparsed one routine\n"
+         << "ms per edit: p50 " << incremental[count / 2] * 1000
+         << ", max " << incremental.back() * 1000 << '\n'
+         << "ms per full parse: p50 " << full[count / 2] * 1000
+         << ", max " << full.back() * 1000 << '\n';
+}
+
+/* Makes one-character edits throughout the code, each followed by one
+   undoing it, relexing the tokens of a TokenDocument, and prints
+   how long relexing takes */
+static void relex_edits(StringRef code, unsigned count) {
+    string text = code.str();
+    TokenDocument<PNode> document(text, PascalGrammar::dictionary());
+    const char* inserted[] = { "x", " ", "1", ";", "'", "{", "}", "(*", "*)" };
+    const size_t kinds = sizeof(inserted) / sizeof(*inserted);
+
+    vector<double> seconds;
+    size_t relexed = 0;
+    auto make = [&](size_t offset, size_t removed, const string& insertion) {
+        text.replace(offset, removed, insertion);
+        auto start = chrono::steady_clock::now();
+        TokenChange change = document.edit(text, offset, removed, insertion.size());
+        seconds.push_back(seconds_since(start));
+        relexed += change.inserted;
+    };
+
+    for (unsigned i = 0; i < count; ++i) {
+        size_t offset = size_t(i) * code.size() / count;
+        string insertion = inserted[i % kinds];
+        make(offset, 0, insertion);
+        make(offset, insertion.size(), "");
+    }
+
+    sort(seconds.begin(), seconds.end());
+    cout << seconds.size() << " edits of " << document.size() << " tokens, "
+         << double(relexed) / seconds.size() << " tokens relexed per edit\n"
+         << "us per edit: p50 " << seconds[seconds.size() / 2] * 1e6
+         << ", p90 " << seconds[seconds.size() * 9 / 10] * 1e6
+         << ", max " << seconds.back() * 1e6 << '\n';
+}
+
+/* Parses the code a number of times and prints how fast nodes are
+   created, how long freeing an AST takes and the peak memory use */
+static void measure_memory(StringRef code, unsigned rounds) {
+    size_t nodes, bytes;
+    {
+        auto arena = NodeArena::make(); // counts the nodes of a parse
+        NodeArena::Scope scope(arena.get());
+        PascalGrammar::parse(code);
+        nodes = arena -> size();
+        bytes = arena -> bytes();
+    }
+
+    double parsing = 0, freeing = 0;
+    for (unsigned r = 0; r < rounds; ++r) {
+        auto start = chrono::steady_clock::now();
+        PNode ast = PascalGrammar::parse(code);
+        auto parsed = chrono::steady_clock::now();
+        ast.reset();
+        auto freed = chrono::steady_clock::now();
+        parsing += chrono::duration<double>(parsed - start).count();
+        freeing += chrono::duration<double>(freed - parsed).count();
+    }
+
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << nodes << " nodes, " << bytes << " bytes in the arena\n"
+         << "parse: " << parsing / rounds * 1000 << " ms, "
+         << nodes * rounds / parsing << " nodes/s\n"
+         << "free: " << freeing / rounds * 1000 << " ms\n"
+         << Atom::count() << " atoms\n"
+         << "peak RSS: " << usage.ru_maxrss / 1024.0 << " MB\n";
+}
+
+/* Copies the AST of the code into a FlatAst, then scans it the way
+   an analysis pass would, counting uses of each name by its atom,
+   and prints how long both take */
+static void scan_flat(StringRef code, unsigned rounds) {
+    PNode ast = PascalGrammar::parse(code);
+    double copying = 0, scanning = 0;
+    size_t identifiers = 0, names = 0, children = 0, bytes = 0, nodes = 0;
+    for (unsigned r = 0; r < rounds; ++r) {
+        auto start = chrono::steady_clock::now();
+        FlatAst flat(ast);
+        auto copied = chrono::steady_clock::now();
+        identifiers = names = children = 0;
+        vector<uint32_t> uses(Atom::count());
+        for (NodeId i = 0; i < flat.size(); ++i) {
+            for (NodeId child : flat.children(i)) {
+                ++children;
+                if (flat.is<IdentifierNode>(child)) {
+                    ++identifiers;
+                    if (uses[flat.atom(child).id()]++ == 0)
+                        ++names;
+                }
+            }
+        }
+        auto scanned = chrono::steady_clock::now();
+        copying += chrono::duration<double>(copied - start).count();
+        scanning += chrono::duration<double>(scanned - copied).count();
+        bytes = flat.bytes();
+        nodes = flat.size();
+    }
+    cout << nodes << " nodes, " << identifiers << " identifiers, "
+         << names << " names, " << children << " child links, " << bytes << " bytes\n"
+         << "copy from the tree: " << copying / rounds * 1000 << " ms\n"
+         << "scan: " << scanning / rounds * 1000 << " ms, "
+         << nodes * rounds / scanning << " nodes/s\n";
+}
+
+static void usage(const char* name) {
+    cout << "usage: " << name << " --generate routines [seed]\n"
+         << "\tprints a program of the given number of procedures\n"
+         << "       " << name << " --lex filename [rounds]\n"
+         << "\tlexes the file (5 times by default) with Token::iterator and by scanning\n"
+         << "\tevery symbol at every token and compares tokens per second;\n"
+         << "\talso prints allocations per token\n"
+         << "       " << name << " --scaling filename [max_threads]\n"
+         << "\tmeasures how parsing the file scales with threads (64 at most by default)\n"
+         << "       " << name << " --batch [-jN] [filename...]\n"
+         << "\tparses the files in N threads (all cores by default), reading\n"
+         << "\ttheir names from stdin if none are given, and prints throughput\n"
+         << "       " << name << " --recover filename [rounds]\n"
+         << "\tmeasures how fast all syntax errors in the file are collected (10 times\n"
+         << "\tby default) and how fast parsing stops at the first one\n"
+         << "       " << name << " --errors routines [every]\n"
+         << "\tgenerates a program of the given number of procedures, breaks every\n"
+         << "\tn-th assignment in it (every 10th by default) and measures how long\n"
+         << "\tcollecting the errors takes per error\n"
+         << "       " << name << " --incremental filename [edits]\n"
+         << "\tedits the program, reparsing it incrementally (20 edits by default),\n"
+         << "\tand compares the latency with full parses\n"
+         << "       " << name << " --relex filename [edits]\n"
+         << "\tmakes and undoes one-character edits (100 by default), relexing\n"
+         << "\tonly around them, and prints the latency\n"
+         << "       " << name << " --memory filename [rounds]\n"
+         << "\tparses the file (10 times by default) and prints the number of nodes,\n"
+         << "\tthe time taken to create and free them and the peak memory use\n"
+         << "       " << name << " --flat filename [rounds]\n"
+         << "\tcopies the AST into a FlatAst (10 times by default) and measures\n"
+         << "\thow long that and a scan of all its nodes take\n";
+}
+
+int main(int argc, const char* argv[]) {
+    try {
+        string mode = argc > 1 ? argv[1] : "";
+        if (mode == "--batch") {
+            parse_batch(argc, argv);
+            return 0;
+        }
+        if (mode == "--generate" && argc > 2) {
+            cout << generate_program(atoi(argv[2]), argc > 3 ? atoi(argv[3]) : 1);
+            return 0;
+        }
+        if (mode == "--errors" && argc > 2) {
+            measure_error_density(atoi(argv[2]), argc > 3 ? max(1, atoi(argv[3])) : 10);
+            return 0;
+        }
+        if (argc < 3) {
+            usage(argv[0]);
+            return 1;
+        }
+
+        MappedFile file(argv[2]);
+        StringRef code = file.text();
+        unsigned n = argc > 3 ? max(1, atoi(argv[3])) : 0;
+        if (mode == "--lex")
+            compare_lexers(code, n ? n : 5);
+        else if (mode == "--scaling")
+            measure_scaling(code, n ? n : 64);
+        else if (mode == "--recover")
+            measure_recovery(code, n ? n : 10);
+        else if (mode == "--incremental")
+            edit_incrementally(code, n ? n : 20);
+        else if (mode == "--relex")
+            relex_edits(code, n ? n : 100);
+        else if (mode == "--memory")
+            measure_memory(code, n ? n : 10);
+        else if (mode == "--flat")
+            scan_flat(code, n ? n : 10);
+        else {
+            usage(argv[0]);
+            return 1;
+        }
+    } catch (SyntaxError& e) {
+        cout << e.what() << endl;
+        return 1;
+    } catch (std::exception& e) {
+        cout << "Error: " << e.what() << endl;
+        return 1;
+    }
+}
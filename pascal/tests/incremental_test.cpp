@@ -0,0 +1,46 @@
+#include "test_utils.h"
+#include "incremental_parser.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+/* Makes edits in a program, updating its AST by IncrementalParser, and
+   fails if the AST after an edit differs from that of a full parse */
+
+int main() {
+    string text = generate_program(300, 7);
+
+    // the first edit makes a routine of two
+    size_t end = text.find("\nend;", text.size() / 2) + 1;
+    vector<TextEdit> edits(1, TextEdit{end, 0, "end; procedure Q; begin "});
+    string edited = text;
+    edited.replace(end, 0, edits[0].inserted);
+
+    // the others turn "x := e" into "x := 1 + e"; made from the end,
+    // so that positions of the remaining ones don't change
+    vector<size_t> positions;
+    for (size_t pos = edited.find(":="); pos != string::npos; pos = edited.find(":=", pos + 2))
+        positions.push_back(pos + 2);
+    const unsigned count = 50;
+    for (unsigned i = 0; i < count; ++i) {
+        size_t pos = positions[positions.size() - 1 -
+                               size_t(i) * positions.size() / count % positions.size()];
+        edits.push_back(TextEdit{pos, 0, " 1 +"});
+    }
+
+    IncrementalParser parser(text);
+    unsigned local = 0, mismatches = 0;
+    for (auto& edit : edits) {
+        local += parser.edit(edit);
+        text.replace(edit.offset, edit.removed, edit.inserted);
+        if (print_ast(parser.ast()) != print_ast(PascalGrammar::parse(text))) {
+            ++mismatches;
+            cout << "edit at " << edit.offset << ": AST differs from a full parse\n";
+        }
+    }
+    cout << edits.size() << " edits, " << local << " reparsed one routine, "
+         << mismatches << " differ from a full parse\n";
+    return mismatches == 0 && local > 0 ? 0 : 1;
+}
@@ -0,0 +1,36 @@
+#include "test_utils.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <algorithm>
+using namespace std;
+
+/* Lexes programs with Token::iterator and by scanning every symbol at
+   every token and fails if the tokens differ */
+
+static size_t count_differences(const string& name, StringRef code) {
+    vector<LexedToken> compiled, scanned;
+    lex_compiled(code, &compiled);
+    lex_scanning(code, &scanned);
+    size_t differences = compiled.size() != scanned.size();
+    for (size_t i = 0; i < min(compiled.size(), scanned.size()); ++i) {
+        if (compiled[i] != scanned[i] && ++differences <= 5)
+            cout << name << ": token at " << compiled[i].start << " is lexed as '"
+                 << compiled[i].symbol -> id << "' instead of '" << scanned[i].symbol -> id
+                 << "' at " << scanned[i].start << '\n';
+    }
+    cout << name << ": " << compiled.size() << " tokens, " << differences << " differ\n";
+    return differences;
+}
+
+int main() {
+    size_t differences = count_differences("sample", SAMPLE_PROGRAM);
+    for (unsigned seed = 1; seed <= 4; ++seed) {
+        differences += count_differences("generated " + to_string(seed),
+                                         generate_program(200, seed));
+        differences += count_differences("generated in mixed case " + to_string(seed),
+                                         generate_program(200, seed, true));
+    }
+    return differences == 0 ? 0 : 1;
+}
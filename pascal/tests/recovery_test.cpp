@@ -0,0 +1,56 @@
+#include "test_utils.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <utility>
+using namespace std;
+
+/* Parses programs with errors, several in a row among them, with
+   recovery and checks that each error is reported once, at the token
+   which caused it, and that the statements after them are kept */
+
+struct Case {
+    const char* program;
+    vector<pair<size_t, size_t>> errors; ///< lines and columns
+    const char* kept; ///< shall be in the printed AST
+};
+
+int main() {
+    const Case cases[] = {
+        { "program p;\nvar z: ;\n    w: integer;\n\nbegin\nend.\n",
+          { {2, 8} }, "IDENTIFIER w" },
+        { "program p;\nbegin\n  x := 1 +; y := 2; z := 3\nend.\n",
+          { {3, 11} }, "IDENTIFIER y" },
+        { "program p;\nbegin\n  x := 1 +;\n  y := * 2;\n  z := 3 -;\nend.\n",
+          { {3, 11}, {4, 8}, {5, 11} }, "STATEMENT SEQUENCE" },
+        { "program p;\nbegin\n  x := ); y := ); z := 1\nend.\n",
+          { {3, 8}, {3, 16} }, "IDENTIFIER z" },
+        { "program p;\nbegin\n  x := 1 + end.\n",
+          { {3, 12} }, "STATEMENT SEQUENCE" },
+        { "program p;\nbegin\n  x := 99999999999999999999; y := 1\nend.\n",
+          { {3, 8} }, "IDENTIFIER y" },
+    };
+
+    size_t failed = 0;
+    for (const Case& c : cases) {
+        ParseResult result = PascalGrammar::parse_with_recovery(c.program);
+        vector<pair<size_t, size_t>> errors;
+        bool clean = true; // messages don't repeat positions
+        for (auto& d : result.diagnostics) {
+            errors.push_back(make_pair(d.position.line, d.position.column));
+            clean &= d.message.find("near line") == string::npos;
+        }
+        if (errors != c.errors || !clean ||
+                print_ast(result.ast).find(c.kept) == string::npos) {
+            ++failed;
+            cout << "unexpected result of\n" << c.program;
+            for (auto& d : result.diagnostics)
+                cout << "line " << d.position.line << ", column " << d.position.column
+                     << ": " << d.message << '\n';
+        }
+    }
+    size_t count = sizeof(cases) / sizeof(*cases);
+    cout << count << " programs, " << failed << " recovered otherwise than expected\n";
+    return failed == 0 ? 0 : 1;
+}
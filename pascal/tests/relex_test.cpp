@@ -0,0 +1,48 @@
+#include "test_utils.h"
+
+#include <iostream>
+#include <string>
+using namespace std;
+
+/* Makes one-character edits throughout a program, each followed by one
+   undoing it, relexing the tokens of a TokenDocument, and fails if the
+   tokens after an edit differ from those of the whole edited text */
+
+int main() {
+    string text = generate_program(100, 3);
+    const size_t size = text.size();
+    TokenDocument<PNode> document(text, PascalGrammar::dictionary());
+    const char* inserted[] = { "x", " ", "1", ";", "'", "{", "}", "(*", "*)" };
+    const size_t kinds = sizeof(inserted) / sizeof(*inserted);
+
+    size_t edits = 0, mismatches = 0;
+    auto make = [&](size_t offset, size_t removed, const string& insertion) {
+        text.replace(offset, removed, insertion);
+        document.edit(text, offset, removed, insertion.size());
+        ++edits;
+
+        TokenDocument<PNode> expected(text, PascalGrammar::dictionary());
+        bool same = expected.size() == document.size();
+        for (size_t i = 0; same && i < expected.size(); ++i)
+            same = expected.is_valid(i) == document.is_valid(i) &&
+                   (!expected.is_valid(i) || &expected.symbol(i) == &document.symbol(i)) &&
+                   expected.start(i) == document.start(i) &&
+                   expected.length(i) == document.length(i);
+        if (!same) {
+            ++mismatches;
+            cout << "edit at " << offset << ": tokens differ from those of the whole text\n";
+        }
+    };
+
+    const unsigned count = 300;
+    for (unsigned i = 0; i < count; ++i) {
+        size_t offset = size_t(i) * size / count;
+        string insertion = inserted[i % kinds];
+        make(offset, 0, insertion);
+        make(offset, insertion.size(), "");
+    }
+
+    cout << edits << " edits of " << document.size() << " tokens, "
+         << mismatches << " differ from lexing the whole text\n";
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,125 @@
+#include "simd_scan.h"
+#include "structural_index.h"
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <random>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
+using namespace std;
+
+/* Character-by-character StructuralIndex: in_comment, in_string and
+   skip for each position, and the beginning of an unterminated region */
+static void index_scalar(const string& text, vector<char>& comment, vector<char>& str, 
+                         vector<char>& skip, size_t& unterminated) {
+    size_t n = text.size();
+    comment.assign(n, 0);
+    str.assign(n, 0);
+    skip.assign(n, 0);
+    unterminated = string::npos;
+    for (size_t i = 0; i < n; ) {
+        size_t end = string::npos; // of a region beginning at i
+        if (text[i] == '\'') {
+            end = text.find('\'', i + 1);
+        } else if (text[i] == '{') {
+            end = text.find('}', i + 1);
+        } else if (text[i] == '(' && i + 1 < n && text[i + 1] == '*') {
+            end = text.find("*)", i + 2);
+            if (end != string::npos)
+                ++end;
+        } else {
+            skip[i] = simd::is_space(text[i]);
+            ++i;
+            continue;
+        }
+        vector<char>& region = text[i] == '\'' ? str : comment;
+        if (end == string::npos) {
+            unterminated = i;
+            end = n - 1;
+        }
+        for (size_t j = i; j <= end; ++j) {
+            region[j] = 1;
+            skip[j] = &region == &comment;
+        }
+        i = end + 1;
+    }
+}
+
+/* Runs simd::skip_digits, skip_word and classify, and a StructuralIndex,
+   over random buffers and compares them with the scalar versions: 
+   from every offset, with every tail length shorter than a block, 
+   and with delimiters of comments and strings across block edges */
+static size_t check_simd(unsigned rounds) {
+    const char alphabet[] = "0123456789azAZ_/:@[`{}'()* \t\n\r\v\f;.\x80\xff";
+    mt19937 random(12345);
+    auto fill = [&](string& s) {
+        for (char& c : s)
+            c = alphabet[random() % (sizeof(alphabet) - 1)];
+    };
+    size_t checks = 0, mismatches = 0;
+    auto expect = [&](bool same, const char* what, const string& s, size_t pos) {
+        ++checks;
+        if (!same && ++mismatches <= 10)
+            cout << what << " differs at " << pos << " of a buffer of " << s.size() << '\n';
+    };
+
+    for (unsigned r = 0; r < rounds; ++r) {
+        /* long runs of digits or word characters ending anywhere in a tail */
+        string s(64 + random() % 256, 'x');
+        fill(s);
+        size_t run = random() % s.size(), run_end = min(s.size(), run + 40 + random() % 100);
+        for (size_t i = run; i < run_end; ++i)
+            s[i] = r % 2 ? '0' + random() % 10 : "aZ_9"[random() % 4];
+
+        for (size_t tail = 0; tail < 64; ++tail) {
+            size_t len = s.size() - tail;
+            for (size_t pos = 0; pos <= len; ++pos) {
+                expect(simd::skip_digits(s.data(), pos, len) == 
+                       simd::scalar::skip_digits(s.data(), pos, len), "skip_digits", s, pos);
+                expect(simd::skip_word(s.data(), pos, len) == 
+                       simd::scalar::skip_word(s.data(), pos, len), "skip_word", s, pos);
+            }
+        }
+
+        for (size_t pos = 0; pos < s.size(); ++pos) {
+            size_t n = s.size() - pos; // every length below 64 near the end
+            char block[64] = { 0 };
+            memcpy(block, s.data() + pos, min<size_t>(n, 64));
+            simd::BlockMasks fast, slow;
+            simd::classify(s.data() + pos, n, fast);
+            simd::scalar::classify(block, slow);
+            expect(memcmp(&fast, &slow, sizeof fast) == 0, "classify", s, pos);
+        }
+
+        /* delimiters put across the edges of blocks */
+        const char* delimiters[] = { "(*", "*)", "'", "''", "{", "}", "(*)", "(**)" };
+        for (size_t edge = 64; edge < s.size(); edge += 64) {
+            const char* d = delimiters[random() % (sizeof(delimiters) / sizeof(*delimiters))];
+            size_t at = edge - random() % strlen(d) - (random() % 2);
+            s.replace(at, strlen(d), d);
+        }
+        StructuralIndex index(s);
+        vector<char> comment, str, skip;
+        size_t unterminated;
+        index_scalar(s, comment, str, skip, unterminated);
+        expect(index.unterminated() == unterminated, "unterminated", s, 0);
+        for (size_t pos = 0; pos < s.size(); ++pos) {
+            size_t next = pos;
+            while (next < s.size() && skip[next])
+                ++next;
+            expect(index.in_comment(pos) == bool(comment[pos]) && 
+                   index.in_string(pos) == bool(str[pos]) &&
+                   index.next_token_start(pos) == next, "structural index", s, pos);
+        }
+    }
+
+    cout << checks << " checks, " << mismatches << " differ from the scalar versions\n";
+    return mismatches;
+}
+
+int main(int argc, const char* argv[]) {
+    return check_simd(argc > 1 ? max(1, atoi(argv[1])) : 200) == 0 ? 0 : 1;
+}
+
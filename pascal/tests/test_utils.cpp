@@ -0,0 +1,256 @@
+#include "test_utils.h"
+
+#include "pretty_printer.h"
+#include "skip_white_space.h"
+
+#include <iostream>
+#include <sstream>
+#include <random>
+#include <stdexcept>
+#include <cctype>
+using namespace std;
+
+const char* const SAMPLE_PROGRAM =
+    "program Test(input, output);\n"
+    "{ a comment\n"
+    "  spanning lines }\n"
+    "label 10, 20;\n"
+    "const\n"
+    "  Max = 100;\n"
+    "  Pi = 3.14159;\n"
+    "  Big = 1.5E10;\n"
+    "  Oct = 17B;\n"
+    "  Name = 'it''s';\n"
+    "type\n"
+    "  Color = (Red, Green, Blue);\n"
+    "  Range = 1..Max;\n"
+    "  Arr = packed array [1..10, Range] of Integer;\n"
+    "  PNode = ^Node;\n"
+    "  Node = record\n"
+    "    Value: Integer;\n"
+    "    Next: PNode;\n"
+    "    case Tag: Boolean of\n"
+    "      True: (X: Real);\n"
+    "      False: (Y, Z: Char)\n"
+    "  end;\n"
+    "  S = set of Color;\n"
+    "var\n"
+    "  I, J, K: Integer;\n"
+    "  A: Arr;\n"
+    "  P: PNode;\n"
+    "  C: Color;\n"
+    "  R: Real;\n"
+    "  St: S;\n"
+    "\n"
+    "(* another comment *)\n"
+    "function Fact(N: Integer): Integer;\n"
+    "begin\n"
+    "  if N <= 1 then Fact := 1\n"
+    "  else Fact := N * Fact(N - 1)\n"
+    "end;\n"
+    "\n"
+    "procedure Swap(var X, Y: Integer);\n"
+    "var T: Integer;\n"
+    "begin\n"
+    "  T := X; X := Y; Y := T\n"
+    "end;\n"
+    "\n"
+    "procedure Outer(N: Integer);\n"
+    "  procedure Inner;\n"
+    "  begin\n"
+    "    N := N + 1\n"
+    "  end;\n"
+    "begin\n"
+    "  Inner;\n"
+    "  WriteLn(N)\n"
+    "end;\n"
+    "\n"
+    "begin\n"
+    "  I := 0;\n"
+    "  J := 10;\n"
+    "  while I < J do\n"
+    "  begin\n"
+    "    I := I + 1;\n"
+    "    if I mod 2 = 0 then J := J - 1\n"
+    "  end;\n"
+    "  for K := 1 to 10 do A[K, 1] := K * K;\n"
+    "  for K := 10 downto 1 do A[K, 2] := -K;\n"
+    "  repeat I := I - 1 until I = 0;\n"
+    "  case C of\n"
+    "    Red: WriteLn('red');\n"
+    "    Green, Blue: WriteLn('other')\n"
+    "  end;\n"
+    "  New(P);\n"
+    "  P^.Value := 42;\n"
+    "  with P^ do Value := Value + 1;\n"
+    "  St := [Red, Blue];\n"
+    "  if Red in St then R := 1.0e-3 * Pi;\n"
+    "  Swap(I, J);\n"
+    "  Outer(3);\n"
+    "  WriteLn(Fact(5), ' ', R:8:3);\n"
+    "10: I := (I + 1) * (J - 2) div 3;\n"
+    "  if not (I > 0) and (J < 0) or (K <> 1) then goto 10\n"
+    "end.\n";
+
+namespace {
+
+    class Generator {
+            mt19937 random;
+            bool mixed_case;
+            stringstream out;
+
+            size_t below(size_t n) { return random() % n; }
+
+            /// \a word in random case if #mixed_case is set
+            string spell(const string& word) {
+                string s = word;
+                if (mixed_case)
+                    for (char& c : s)
+                        if (below(2))
+                            c = toupper(c);
+                return s;
+            }
+
+            string expression(unsigned depth = 0) {
+                if (depth > 3 || below(10) < 3) {
+                    const char* operands[] = { "x", "y", "z", "a[1]", "c0", "17B", "1.5E-3", "r0" };
+                    if (below(4) == 0)
+                        return to_string(below(1001));
+                    return spell(operands[below(sizeof(operands) / sizeof(*operands))]);
+                }
+                const char* operators[] = { "+", "-", "*", "div", "mod", "and", "or" };
+                return "(" + expression(depth + 1) + " " +
+                       spell(operators[below(sizeof(operators) / sizeof(*operators))]) + " " +
+                       expression(depth + 1) + ")";
+            }
+
+            void statement(size_t routine, size_t j) {
+                switch (below(6)) {
+                    case 0: case 1:
+                        out << "  q := " << expression() << ";\n";
+                        break;
+                    case 2:
+                        out << "  " << spell("if") << " q > " << j << " " << spell("then")
+                            << " r := " << expression() << " " << spell("else")
+                            << " r := " << expression() << ";\n";
+                        break;
+                    case 3:
+                        out << "  " << spell("while") << " q < " << j << " " << spell("do")
+                            << " " << spell("begin") << " q := q + 1; { c } x := x - 1 "
+                            << spell("end") << ";\n";
+                        break;
+                    case 4:
+                        out << "  " << spell("for") << " loc" << routine << " := 1 "
+                            << spell("to") << " 10 " << spell("do") << " WriteLn('s''t', q);\n";
+                        break;
+                    default:
+                        out << "  " << spell("repeat") << " q := q - 1 (* down *) "
+                            << spell("until") << " q <= " << j << ";\n";
+                }
+            }
+
+        public:
+            Generator(unsigned seed, bool mixed_case) : random(seed), mixed_case(mixed_case) {}
+
+            string program(size_t routines) {
+                out << spell("program") << " Big(Input, Output);\n{ banner\n  header }\n"
+                    << spell("const") << " C0 = 10; R0 = 2.5e3;\n"
+                    << spell("type") << " T0 = " << spell("array") << " [1..10] "
+                    << spell("of") << " Integer;\n"
+                    << spell("var") << " x, y, z: Integer; a: T0;\n";
+                for (size_t i = 0; i < routines; ++i) {
+                    out << "(* routine " << i << " *)\n"
+                        << spell("procedure") << " P" << i << "(" << spell("var")
+                        << " q: Integer; r: Integer);\n"
+                        << spell("var") << " loc" << i << ": Integer;\n"
+                        << spell("begin") << '\n';
+                    for (size_t j = 0, n = 2 + below(7); j < n; ++j)
+                        statement(i, j);
+                    out << "  z := r\n" << spell("end") << ";\n";
+                }
+                out << spell("begin") << '\n';
+                for (size_t i = 0; i < routines && i < 50; ++i)
+                    out << "  P" << i << "(x, " << expression() << ");\n";
+                out << "  x := 1\n" << spell("end") << ".\n";
+                return out.str();
+            }
+    };
+}
+
+string generate_program(size_t routines, unsigned seed, bool mixed_case) {
+    return Generator(seed, mixed_case).program(routines);
+}
+
+string print_ast(const PNode& node) {
+    stringstream out;
+    streambuf* old = cout.rdbuf(out.rdbuf());
+    PrettyPrinter pp;
+    pp.travel(node);
+    cout.rdbuf(old);
+    return out.str();
+}
+
+void lex_compiled(StringRef code, vector<LexedToken>* tokens) {
+    const SymbolDict<PNode>& symbols = PascalGrammar::dictionary();
+    for (Token<PNode>::iterator it(code, symbols); ; ++it) {
+        Token<PNode> token = *it;
+        if (&token.symbol() == &symbols.end_symbol())
+            break;
+        if (tokens != nullptr)
+            tokens -> push_back(LexedToken{&token.symbol(), token.start_position, token.length});
+    }
+}
+
+void lex_scanning(StringRef code, vector<LexedToken>* tokens) {
+    const SymbolDict<PNode>& symbols = PascalGrammar::dictionary();
+    const Symbol<PNode>* identifier = nullptr;
+    for (auto it = symbols.cbegin(); it != symbols.cend(); ++it)
+        if (it -> second.reserves_keywords())
+            identifier = &it -> second;
+
+    /* Symbol::scan compares ids case-sensitively, and the dictionary is not */
+    auto scan_id = [&](const string& id, size_t pos) {
+        for (size_t i = 0; i < id.length(); ++i) {
+            if (pos + i >= code.length() ||
+                    id[i] != (symbols.is_case_sensitive() ? code[pos + i]
+                                                          : lexer::fold_case(code[pos + i])))
+                return pos;
+        }
+        return pos + id.length();
+    };
+    auto match = [&](size_t start, size_t& end) {
+        const Symbol<PNode>* match = nullptr;
+        end = start;
+        for (auto it = symbols.cbegin(); it != symbols.cend(); ++it) {
+            const Symbol<PNode>& sym = it -> second;
+            size_t p = sym.has_scanner() ? sym.scan(code, start) : scan_id(sym.id, start);
+            /* longest match with highest precedence */
+            if (p > end || (match != nullptr && sym.lbp > match -> lbp && p == end)) {
+                match = &sym;
+                end = p;
+            }
+        }
+        if (match != nullptr && match == identifier) { // reserved words
+            for (auto it = symbols.cbegin(); it != symbols.cend(); ++it) {
+                if (!it -> second.has_scanner() && it -> first.length() == end - start &&
+                        scan_id(it -> first, start) == end)
+                    match = &it -> second;
+            }
+        }
+        return match;
+    };
+
+    token::SkipWhiteSpace<PNode> skip_white_space(code);
+    for (size_t start = 0, end; ; start = end) {
+        skip_white_space(code, start);
+        if (start >= code.length())
+            break;
+        const Symbol<PNode>* symbol = match(start, end);
+        if (symbol == nullptr)
+            throw runtime_error("invalid symbol");
+        if (symbol -> has_parser())
+            symbol -> parse(code, start, end);
+        if (tokens != nullptr)
+            tokens -> push_back(LexedToken{symbol, start, end - start});
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef TEST_UTILS_H
+#define TEST_UTILS_H
+
+#include "pascal_grammar.h"
+
+#include <string>
+#include <vector>
+
+/// A program using most of the grammar, with both kinds of comments
+extern const char* const SAMPLE_PROGRAM;
+
+/** Generates a program of \a routines procedures with random statements
+ *  and expressions; the same seed gives the same program. If \a mixed_case
+ *  is true, keywords and names are spelled in random case.
+ */
+std::string generate_program(size_t routines, unsigned seed, bool mixed_case = false);
+
+/// The output of PrettyPrinter for \a node
+std::string print_ast(const PNode& node);
+
+/// Token as the lexers below see it
+struct LexedToken {
+    const Symbol<PNode>* symbol;
+    size_t start, length;
+
+    bool operator!=(const LexedToken& other) const {
+        return symbol != other.symbol || start != other.start || length != other.length;
+    }
+};
+
+/// Lexes \a code with Token::iterator, appending the tokens to \a tokens if it isn't null
+void lex_compiled(StringRef code, std::vector<LexedToken>* tokens);
+
+/** Lexes \a code the way Token::iterator did before the symbols were
+ *  compiled into a Lexer, scanning every symbol of the dictionary at
+ *  every token; appends the tokens to \a tokens if it isn't null
+ */
+void lex_scanning(StringRef code, std::vector<LexedToken>* tokens);
+
+#endif